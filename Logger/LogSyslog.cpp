@@ -0,0 +1,31 @@
+/*
+    LogSyslog.cpp - SyslogSink, Linux / host builds only
+
+    Apart from Logger.cpp because <syslog.h> defines its own LOG_INFO.
+
+*/
+#ifndef ARDUINO
+#include <syslog.h>
+
+static const int PRIORITY_ERR = LOG_ERR;
+static const int PRIORITY_INFO = LOG_INFO;
+#undef LOG_INFO
+
+#include"Logger.h"
+
+SyslogSink::SyslogSink(const char* ident, uint8_t lvl) : LogSink(lvl) {
+    openlog(ident, LOG_PID, LOG_USER);
+}
+
+void SyslogSink::write(const char* line, uint8_t len) {
+    writeLine(LOG_INFO, line, len);
+}
+
+void SyslogSink::writeLine(uint8_t messageLevel, const char* line, uint8_t len) {
+    int priority = messageLevel == LOG_INFO ? PRIORITY_INFO : PRIORITY_ERR;
+    if (len > 0 && line[len - 1] == '\n') {
+        len--; // syslog ends the record itself
+    }
+    syslog(priority, "%.*s", (int)len, line);
+}
+#endif
@@ -16,144 +16,379 @@
 #include<Arduino.h>
 #include"Logger.h"
 
+#define RAMSINK_MAGIC 0x4C47
+
+// *** SINKS ***
+
+LogSink::LogSink(uint8_t lvl) {
+    level = lvl;
+    dropped = 0;
+    tokens = 0;
+    burst = 0;
+    perSecond = 0;
+    lastRefill = 0;
+}
+
+void LogSink::setRateLimit(uint8_t size, uint16_t rate) {
+    burst = size;
+    perSecond = rate;
+    tokens = size;
+    lastRefill = millis();
+}
+
+bool LogSink::accept(uint8_t messageLevel) {
+    if (messageLevel == LOG_OFF || messageLevel > level) {
+        return false;
+    }
+    if (perSecond == 0) {
+        return true;
+    }
+
+    // refill whole tokens, keep the remainder of the interval for next time
+    unsigned long now = millis();
+    unsigned long earned = (now - lastRefill) * perSecond / 1000;
+    if (earned > 0) {
+        tokens = (tokens + earned > burst) ? burst : tokens + earned;
+        lastRefill += earned * 1000 / perSecond;
+    }
+
+    if (tokens == 0) {
+        dropped++;
+        return false;
+    }
+    tokens--;
+    return true;
+}
+
+void LogSink::writeLine(uint8_t messageLevel, const char* line, uint8_t len) {
+    write(line, len);
+}
+
+SerialSink::SerialSink(Print& port, uint8_t lvl) : LogSink(lvl) {
+    out = &port;
+}
+
+void SerialSink::write(const char* line, uint8_t len) {
+    out->write((const uint8_t*)line, len);
+}
+
+RamSink::RamSink(char* buffer, unsigned int size, uint8_t lvl) : LogSink(lvl) {
+    base = buffer;
+    data = buffer + sizeof(Header);
+    capacity = size - sizeof(Header);
+
+    // a NOINIT buffer still holds the last run's log after a reset
+    Header header = load();
+    if (header.magic != RAMSINK_MAGIC || header.head >= capacity) {
+        clear();
+    }
+}
+
+// the buffer may be a char array at any address, so the header is copied
+// rather than accessed in place (unaligned uint16_t faults on Cortex-M0)
+RamSink::Header RamSink::load() {
+    Header header;
+    memcpy(&header, base, sizeof(Header));
+    return header;
+}
+
+void RamSink::store(const Header& header) {
+    memcpy(base, &header, sizeof(Header));
+}
+
+void RamSink::clear() {
+    Header header;
+    header.magic = RAMSINK_MAGIC;
+    header.head = 0;
+    header.wrapped = 0;
+    store(header);
+}
+
+void RamSink::write(const char* line, uint8_t len) {
+    Header header = load();
+    unsigned int head = header.head;
+    for (uint8_t i = 0; i < len; i++) {
+        data[head++] = line[i];
+        if (head == capacity) {
+            head = 0;
+            header.wrapped = 1;
+        }
+    }
+    header.head = head;
+    store(header);
+}
+
+void RamSink::dump(Print& out) {
+    Header header = load();
+    unsigned int head = header.head;
+    if (header.wrapped) {
+        // skip the partial line the writer cut into
+        unsigned int start = head;
+        while (start < capacity && data[start] != '\n') {
+            start++;
+        }
+        if (start + 1 < capacity) {
+            out.write((const uint8_t*)data + start + 1, capacity - start - 1);
+        }
+    }
+    out.write((const uint8_t*)data, head);
+}
+
+#ifndef ARDUINO
+FileSink::FileSink(FILE* file, uint8_t lvl) : LogSink(lvl) {
+    out = file;
+}
+
+void FileSink::write(const char* line, uint8_t len) {
+    fwrite(line, 1, len, out);
+}
+#endif
+
+// *** LINE FORMATTING ***
+
+LogLine::LogLine() {
+    len = 0;
+}
+
+LogLine& LogLine::append(const char* text) {
+    while (*text && len < LOGGER_LINE - 1) { // keep space for '\n'
+        this->text[len++] = *text++;
+    }
+    return *this;
+}
+
+LogLine& LogLine::append(char* text) {
+    return append((const char*)text);
+}
+
+LogLine& LogLine::append(unsigned long value) {
+    char digits[11];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n && len < LOGGER_LINE - 1) {
+        text[len++] = digits[--n];
+    }
+    return *this;
+}
+
+LogLine& LogLine::append(long value) {
+    if (value < 0) {
+        append("-");
+        return append(-(unsigned long)value);
+    }
+    return append((unsigned long)value);
+}
+
+LogLine& LogLine::append(int value) {
+    return append((long)value);
+}
+
+LogLine& LogLine::append(unsigned int value) {
+    return append((unsigned long)value);
+}
+
+LogLine& LogLine::append(float value) {
+    if (value < 0) {
+        append("-");
+        value = -value;
+    }
+    unsigned long hundredths = (unsigned long)(value * 100 + 0.5);
+    char fraction[] = {'.', (char)('0' + (hundredths / 10) % 10), (char)('0' + hundredths % 10), '\0'};
+    return append(hundredths / 100).append(fraction);
+}
+
+void LogLine::end() {
+    text[len++] = '\n';
+}
+
+char* LogLine::str() {
+    text[len] = '\0';
+    return text;
+}
+
+// *** LOGGER ***
+
+static uint8_t parseLevel(const char* level) {
+    if (strcmp(level, "info") == 0) {
+        return LOG_INFO;
+    } else if (strcmp(level, "error") == 0) {
+        return LOG_ERROR;
+    } else if (strcmp(level, "global") == 0) {
+        return LOG_GLOBAL;
+    }
+    return LOG_OFF;
+}
 
 Logger::Logger(char* tagg, char* level) {
     tag = tagg;
     lvl = level;
+    this->level = parseLevel(level);
+    sinkCount = 0;
+    for (uint8_t i = 0; i < LOGGER_DEDUP_SLOTS; i++) {
+        repeats[i].reg = 0;
+        repeats[i].count = 0;
+        repeats[i].windowStart = 0;
+    }
 }
 
 void Logger::setLevel(char* level) {
-    if (level == "info") {
+    this->level = parseLevel(level);
+    if (this->level == LOG_INFO) {
         lvl = "info";
-    } else if (level == "error") {
+    } else if (this->level == LOG_ERROR) {
         lvl = "error";
-    } else if (level == "global") {
+    } else if (this->level == LOG_GLOBAL) {
         lvl = "global";
     } else {
         lvl = "off";
     }
 }
 
-void Logger::logi(char* message) {
-    if (lvl == "info") {
-        Serial.print(tag);
-        Serial.print(" - INFO: ");
-        Serial.println(message);
+bool Logger::addSink(LogSink* sink) {
+    if (sinkCount >= LOGGER_MAX_SINKS) {
+        return false;
     }
+    sinks[sinkCount++] = sink;
+    return true;
 }
 
-void Logger::loge(char* message) {
-    if (lvl == "info" || lvl == "error") {
-        Serial.print(tag);
-        Serial.print(" - ERROR: ");
-        Serial.println(message);
+bool Logger::enabled(uint8_t messageLevel) {
+    if (messageLevel == LOG_OFF || messageLevel > level) {
+        return false;
+    }
+    if (sinkCount == 0) {
+        return true;
+    }
+    for (uint8_t i = 0; i < sinkCount; i++) {
+        if (messageLevel <= sinks[i]->level) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Logger::begin(LogLine& line, const char* label) {
+    line.append(tag).append(" - ").append(label).append(": ");
+}
+
+void Logger::emit(uint8_t messageLevel, LogLine& line) {
+    if (messageLevel == LOG_OFF || messageLevel > level) {
+        return; // flush() summaries come here without enabled()
+    }
+    line.end();
+
+    if (sinkCount == 0) {
+#ifdef ARDUINO
+        Serial.write((const uint8_t*)line.text, line.len);
+#else
+        fwrite(line.text, 1, line.len, stderr);
+#endif
+        return;
+    }
+    for (uint8_t i = 0; i < sinkCount; i++) {
+        if (sinks[i]->accept(messageLevel)) {
+            sinks[i]->writeLine(messageLevel, line.text, line.len);
+        }
     }
 }
 
+void Logger::log(uint8_t messageLevel, const char* label, char* message) {
+    if (!enabled(messageLevel)) {
+        return; // nobody listens, skip formatting
+    }
+    LogLine line;
+    begin(line, label);
+    line.append(message);
+    emit(messageLevel, line);
+}
+
+void Logger::logi(char* message) {
+    log(LOG_INFO, "INFO", message);
+}
+
+void Logger::loge(char* message) {
+    log(LOG_ERROR, "ERROR", message);
+}
+
 void Logger::logg(char* message) {
-    if (lvl == "global" || lvl == "error" || lvl == "info") {
-        Serial.print(tag);
-        Serial.print(" - GLOBAL: ");
-        Serial.println(message);
-    }
-}
-
-bool Logger::logSet(char* reg, char* subreg, char* setting, bool success) {
-    
-    if (success && lvl == "info")  {
-        Serial.print(tag);
-        Serial.print(" - INFO: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write success");
-    } else if(!success && (lvl == "error" || lvl == "info")) {
-        Serial.print(tag);
-        Serial.print(" - ERROR: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write fail");
-    }
-
-    return success;
-}
-
-bool Logger::logSet(char* reg, char* subreg, int setting, bool success){
-     
-     if (success && lvl == "info")  {
-        Serial.print(tag);
-        Serial.print(" - INFO: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write success");
-    } else if(!success && (lvl == "error" || lvl == "info")) {
-        Serial.print(tag);
-        Serial.print(" - ERROR: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write fail");
-    }
-
-    return success;
-}
-
-bool Logger::logSet(char* reg, char* subreg, float setting, bool success){
-     
-     if (success && lvl == "info")  {
-        Serial.print(tag);
-        Serial.print(" - INFO: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write success");
-    } else if(!success && (lvl == "error" || lvl == "info")) {
-        Serial.print(tag);
-        Serial.print(" - ERROR: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write fail");
-    }
-
-    return success;
-}
-
-bool Logger::logSet(char* reg, char* subreg, unsigned int setting, bool success){
-     
-     if (success && lvl == "info")  {
-        Serial.print(tag);
-        Serial.print(" - INFO: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write success");
-    } else if(!success && (lvl == "error" || lvl == "info")) {
-        Serial.print(tag);
-        Serial.print(" - ERROR: ");
-        Serial.print(reg);
-        Serial.print(" register, ");
-        Serial.print(subreg);
-        Serial.print(" subregister, ");
-        Serial.print(setting);
-        Serial.println(" write fail");
-    }
-
-    return success;
+    log(LOG_GLOBAL, "GLOBAL", message);
+}
+
+void Logger::logRepeat(Repeat& repeat) {
+    LogLine line;
+    begin(line, repeat.success ? "INFO" : "ERROR");
+    line.append(repeat.reg).append(" register, ").append(repeat.subreg).append(" subregister, ")
+        .append(repeat.success ? "write success" : "write fail")
+        .append(" repeated ").append(repeat.count).append(" times");
+
+    emit(repeat.success ? LOG_INFO : LOG_ERROR, line);
+    repeat.count = 0;
+}
+
+bool Logger::firstOccurrence(char* reg, char* subreg, bool success) {
+    unsigned long now = millis();
+    Repeat* oldest = &repeats[0];
+
+    for (uint8_t i = 0; i < LOGGER_DEDUP_SLOTS; i++) {
+        Repeat& r = repeats[i];
+        if (r.reg == reg && r.subreg == subreg && r.success == success) {
+            if (now - r.windowStart < LOGGER_DEDUP_PERIOD) {
+                if (r.count < 0xFFFF) {
+                    r.count++;
+                }
+                return false;
+            }
+            // window over: a storm gets its summary, a lone repeat prints normally
+            r.windowStart = now;
+            if (r.count > 0) {
+                r.count++;
+                logRepeat(r);
+                return false;
+            }
+            return true;
+        }
+        if (oldest->reg != 0 && (r.reg == 0 || (long)(r.windowStart - oldest->windowStart) < 0)) {
+            oldest = &r; // empty slot, or started before the current pick
+        }
+    }
+
+    // new key, evict the oldest slot (its pending summary first)
+    if (oldest->reg != 0 && oldest->count > 0) {
+        logRepeat(*oldest);
+    }
+    oldest->reg = reg;
+    oldest->subreg = subreg;
+    oldest->success = success;
+    oldest->count = 0;
+    oldest->windowStart = now;
+    return true;
+}
+
+void Logger::flush() {
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < LOGGER_DEDUP_SLOTS; i++) {
+        Repeat& r = repeats[i];
+        if (r.reg != 0 && r.count > 0 && now - r.windowStart >= LOGGER_DEDUP_PERIOD) {
+            logRepeat(r);
+            r.windowStart = now;
+        }
+    }
+}
+
+bool Logger::logSetBegin(LogLine& line, char* reg, char* subreg, bool success) {
+    if (!firstOccurrence(reg, subreg, success)) {
+        return false;
+    }
+
+    begin(line, success ? "INFO" : "ERROR");
+    line.append(reg).append(" register, ").append(subreg).append(" subregister, ");
+    return true;
+}
+
+void Logger::logSetEnd(LogLine& line, bool success) {
+    line.append(success ? " write success" : " write fail");
+    emit(success ? LOG_INFO : LOG_ERROR, line);
 }
@@ -3,7 +3,7 @@
 
     Created by Sergio Mauricio Guerrero for REV. March 16, 2018
 
-    Outputs log messages to serial port
+    Outputs log messages to serial port, or to any set of sinks
 
     Usage:
     initialize a Logger object:
@@ -12,12 +12,209 @@
     logger.logi("info message");
     logger.loge("error message");
 
+    With sinks (each with its own level and rate limit):
+    char crashLog[512] LOGGER_NOINIT;
+    RamSink ram(crashLog, sizeof(crashLog), LOG_INFO);
+    SerialSink uart(Serial, LOG_ERROR);
+    uart.setRateLimit(5, 2); // bursts of 5, then 2 lines per second
+
+    logger.addSink(&ram);
+    logger.addSink(&uart);
+
+    After a reset ram still holds the previous run's lines, ram.dump(Serial)
+    prints them.
+
+    On Linux lines go to stderr without sinks; FileSink and SyslogSink are
+    there for log files and syslog.
+
 */
 
 #pragma once
 
 #include <Arduino.h>
 
+// log levels, a message is printed when its level is at or below the Logger's
+// (setLevel) and, with sinks, at or below the sink's
+#define LOG_OFF 0
+#define LOG_GLOBAL 1
+#define LOG_ERROR 2
+#define LOG_INFO 3
+
+#define LOGGER_MAX_SINKS 4
+
+// longest formatted line, longer lines are cut
+#define LOGGER_LINE 96
+
+// logSet storm suppression: distinct (reg, subreg, outcome) keys tracked, and
+// how often (ms) a "repeated N times" summary is let through for each
+#define LOGGER_DEDUP_SLOTS 4
+#define LOGGER_DEDUP_PERIOD 1000
+
+// keeps a RamSink buffer through a reset (not cleared by the startup code)
+#if defined(__AVR__)
+#define LOGGER_NOINIT __attribute__((section(".noinit")))
+#else
+#define LOGGER_NOINIT
+#endif
+
+/*
+destination for log lines
+*/
+class LogSink {
+    public:
+
+     LogSink(uint8_t level);
+
+     /*
+     LOG_OFF/LOG_GLOBAL/LOG_ERROR/LOG_INFO
+     */
+     uint8_t level;
+
+     /*
+     token bucket: up to burst lines at once, refilled at perSecond lines/s
+     perSecond 0 turns rate limiting off (default)
+     */
+     void setRateLimit(uint8_t burst, uint16_t perSecond);
+
+     /*
+     lines refused by the rate limit
+     */
+     unsigned long dropped;
+
+     /*
+     true if a message of this level should go to this sink (takes a token)
+     */
+     bool accept(uint8_t messageLevel);
+
+     /*
+     line includes the trailing '\n', len is its length
+     */
+     virtual void write(const char* line, uint8_t len) = 0;
+
+     /*
+     what the Logger calls, with the message level for sinks that keep it
+     (syslog priority); the default just writes the line
+     */
+     virtual void writeLine(uint8_t messageLevel, const char* line, uint8_t len);
+
+    private:
+
+     uint8_t tokens;
+     uint8_t burst;
+     uint16_t perSecond;
+     unsigned long lastRefill;
+};
+
+/*
+writes lines to a Print (Serial, SoftwareSerial, ...)
+*/
+class SerialSink : public LogSink {
+    public:
+     SerialSink(Print& port, uint8_t level);
+     void write(const char* line, uint8_t len);
+
+    private:
+     Print* out;
+};
+
+/*
+circular buffer in RAM, survives a reset when the buffer is LOGGER_NOINIT
+*/
+class RamSink : public LogSink {
+    public:
+     /*
+     keeps the old content if buffer holds a valid log from before a reset
+     */
+     RamSink(char* buffer, unsigned int size, uint8_t level);
+     void write(const char* line, uint8_t len);
+
+     /*
+     prints the buffer oldest line first
+     */
+     void dump(Print& out);
+
+     /*
+     empties the buffer
+     */
+     void clear();
+
+    private:
+
+     struct Header {
+         uint16_t magic;
+         uint16_t head;
+         uint8_t wrapped;
+     };
+
+     char* base;          // Header, then data
+     char* data;
+     unsigned int capacity;
+
+     Header load();
+     void store(const Header& header);
+};
+
+#ifndef ARDUINO
+#include <stdio.h>
+
+/*
+host build: writes lines to a FILE* (stdout, stderr, a log file)
+*/
+class FileSink : public LogSink {
+    public:
+     FileSink(FILE* file, uint8_t level);
+     void write(const char* line, uint8_t len);
+
+    private:
+     FILE* out;
+};
+
+/*
+host build: writes lines to syslog(3), LOG_ERROR and LOG_GLOBAL at LOG_ERR
+priority and the rest at syslog's LOG_INFO (include <syslog.h> before this
+header and its LOG_INFO wins, so keep them in separate files)
+*/
+class SyslogSink : public LogSink {
+    public:
+     SyslogSink(const char* ident, uint8_t level);
+     void write(const char* line, uint8_t len);
+     void writeLine(uint8_t messageLevel, const char* line, uint8_t len);
+};
+#endif
+
+/*
+one log line built in place: fixed buffer, no heap, cut at LOGGER_LINE
+*/
+class LogLine {
+    public:
+     LogLine();
+
+     LogLine& append(const char* text);
+     LogLine& append(char* text);
+     LogLine& append(long value);
+     LogLine& append(unsigned long value);
+     LogLine& append(int value);
+     LogLine& append(unsigned int value);
+
+     /*
+     two decimals, the same as Serial.print(float)
+     */
+     LogLine& append(float value);
+
+     /*
+     terminates the line with '\n'
+     */
+     void end();
+
+     /*
+     the text so far as a C string (for passing to logi/loge)
+     */
+     char* str();
+
+     char text[LOGGER_LINE];
+     uint8_t len;
+};
+
 class Logger {
 
     public: 
@@ -38,9 +235,17 @@ class Logger {
      "off" - nothing except globals
      "error" - only errors
      "info" - all messages
+     without sinks this is the Serial (Linux: stderr) level; with sinks it
+     is the global ceiling, each sink keeps its own level below it
      */
      void setLevel(char* level);
 
+     /*
+     adds an output, returns false if LOGGER_MAX_SINKS are already attached
+     once a sink is added messages only go to sinks
+     */
+     bool addSink(LogSink* sink);
+
      /*
      info log message
      */
@@ -63,21 +268,88 @@ class Logger {
      logging for Setter functions of DRV
      if success : logs info - "TAG - reg register subreg setting write success"
      else : logs error - "TAG - reg register subreg setting write fail"
-    
+
      Usage:
         bool success = drv.write(CTRL, value));
         logSet("CTRL", "ENBL", "on", success);
-    
 
+
+     */
+     template <typename T>
+     bool logSet(char* reg, char* subreg, T setting, bool success) {
+         if (enabled(success ? LOG_INFO : LOG_ERROR)) {
+             logSetLine(reg, subreg, setting, success);
+         }
+         return success;
+     }
+
+     /*
+     repeated logSet lines (same reg, subreg and outcome) are only printed
+     the first time, then as one "repeated N times" line per LOGGER_DEDUP_PERIOD.
+     flush() prints summaries that are due without waiting for the next repeat,
+     call it from loop() if a storm may stop abruptly
+     */
+     void flush();
+
+    private:
+
+     struct Repeat {
+         const char* reg;
+         const char* subreg;
+         bool success;
+         uint16_t count;      // suppressed since windowStart
+         unsigned long windowStart;
+     };
+
+     Repeat repeats[LOGGER_DEDUP_SLOTS];
+
+     /*
+     true if this logSet line should be printed
      */
-     bool logSet(char* reg, char* subreg, char* setting, bool success);
+     bool firstOccurrence(char* reg, char* subreg, bool success);
 
-     bool logSet(char* reg, char* subreg, int setting, bool success);
+     void logRepeat(Repeat& repeat);
 
-     bool logSet(char* reg, char* subreg, float setting, bool success);
+     uint8_t level;
 
-     bool logSet(char* reg, char* subreg, unsigned int setting, bool success);
+     LogSink* sinks[LOGGER_MAX_SINKS];
+     uint8_t sinkCount;
 
+     /*
+     true if any output takes this level (nothing is formatted otherwise)
+     */
+     bool enabled(uint8_t messageLevel);
+
+     /*
+     starts line with "TAG - LABEL: "
+     */
+     void begin(LogLine& line, const char* label);
+
+     /*
+     ends line and hands it to every accepting output in one write each
+     */
+     void emit(uint8_t messageLevel, LogLine& line);
+
+     void log(uint8_t messageLevel, const char* label, char* message);
+
+     /*
+     the line of a logSet that passed the level check; out of line so the
+     LogLine buffer is only on the stack when something will be printed
+     */
+     template <typename T>
+     __attribute__((noinline)) void logSetLine(char* reg, char* subreg, T setting, bool success) {
+         LogLine line;
+         if (logSetBegin(line, reg, subreg, success)) {
+             line.append(setting);
+             logSetEnd(line, success);
+         }
+     }
+
+     /*
+     the non template halves of logSet, false if the line is suppressed
+     */
+     bool logSetBegin(LogLine& line, char* reg, char* subreg, bool success);
 
+     void logSetEnd(LogLine& line, bool success);
 
 };
@@ -0,0 +1,38 @@
+/*
+  bench.h - timing helpers for the host benchmarks
+
+  Each benchmark is its own program (see CMakeLists.txt). The iteration
+  count is the first argument; ctest runs every benchmark with a small one
+  (label "bench") so they keep building and running, a real measurement
+  passes a larger one:
+
+    ./bench_transfer 1000000
+
+  Results go to stdout as "name: value unit" lines.
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+// wall clock, ns
+static inline uint64_t benchNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// iterations from argv[1], or fallback
+static inline unsigned long benchIterations(int argc, char** argv, unsigned long fallback) {
+  if (argc > 1) {
+    unsigned long n = strtoul(argv[1], 0, 10);
+    if (n > 0) {
+      return n;
+    }
+  }
+  return fallback;
+}
+
+static inline void benchReport(const char* name, double value, const char* unit) {
+  printf("%s: %.1f %s\n", name, value, unit);
+}
@@ -0,0 +1,71 @@
+/*
+  bench_current.cpp - CurrentController step cost and step response
+
+  CPU time per step() with a fixed ISENSE reading, so only the loop, the
+  ripple bookkeeping and the TORQUE update against a drvSim are timed. Then
+  the step response on drvPlant (sense resistor 20% off nominal, as in
+  tests/test_current.cpp): a step to 300 counts from rest, one loop step per
+  600 us of plant time; rise is the time to 90% of the target, settling the
+  time after which it stays within 2%.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvPlant.h>
+#include <drvCurrent.h>
+#include "bench.h"
+
+#define TARGET 300
+#define BAND 6
+#define STEP_MICROS 600
+#define STEPS 200
+
+// ISENSE that wobbles around a level, so the loop keeps correcting
+class FixedAdc : public drvAdc {
+    public:
+        FixedAdc() { n = 0; }
+        uint16_t sample() { return 290 + (n++ & 0x0F); }
+        unsigned int n;
+};
+
+int main(int argc, char** argv) {
+  unsigned long n = benchIterations(argc, argv, 1000000);
+  {
+    drvSim sim;
+    drv motor(0, sim);
+    FixedAdc adc;
+    CurrentController loop(motor, adc, 1000);
+    loop.setTarget(TARGET);
+    uint64_t start = benchNanos();
+    for (unsigned long i = 0; i < n; i++) {
+      loop.step();
+    }
+    benchReport("CurrentController::step()", (double)(benchNanos() - start) / n, "ns/step");
+  }
+
+  drvSim sim;
+  drvPlant plant(sim);
+  drv motor(0, sim);
+  plant.rsense = 0.06;
+  CurrentController loop(motor, plant, 1000);
+  loop.setTarget(TARGET);
+  int rise = -1;
+  int settled = -1;
+  for (int i = 0; i < STEPS; i++) {
+    plant.advance(STEP_MICROS);
+    loop.step();
+    int error = (int)loop.measured - TARGET;
+    if (rise < 0 && loop.measured >= TARGET * 9 / 10) {
+      rise = i + 1;
+    }
+    if (error > BAND || error < -BAND) {
+      settled = -1;
+    } else if (settled < 0) {
+      settled = i + 1;
+    }
+  }
+  benchReport("rise to 90%", rise * STEP_MICROS / 1000.0, "ms");
+  benchReport("settled within 2%", settled * STEP_MICROS / 1000.0, "ms");
+  return 0;
+}
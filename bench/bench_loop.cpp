@@ -0,0 +1,71 @@
+/*
+  bench_loop.cpp - loop() latency, blocking getCurrentRegisters() vs ProbeTask
+
+  loop() passes on a VirtualClock with a ClockedTransport at 140 kHz, so each
+  frame costs its real SPI time. Every pass does a little other work; every
+  100th pass also probes the registers, either blocking or by starting a
+  ProbeTask that the following passes poll. Reported: the longest pass and
+  the mean pass, in simulated us, plus the CPU time per poll() on this host.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvTask.h>
+#include <drvClock.h>
+#include "bench.h"
+
+static void measure(const char* name, unsigned long passes, bool blocking) {
+  VirtualClock clock(1);
+  clock.install();
+  drvSim sim;
+  ClockedTransport bus(sim, clock);
+  drv motor(0, bus);
+  ProbeTask probe(&motor);
+  probe.state = TASK_DONE;
+
+  uint64_t worst = 0;
+  uint64_t total = 0;
+  for (unsigned long i = 0; i < passes; i++) {
+    uint64_t start = clock.now();
+    if (i % 100 == 0) {
+      if (blocking) {
+        motor.getCurrentRegisters();
+      } else {
+        probe.restart();
+      }
+    }
+    probe.poll();
+    delayMicroseconds(50); // the rest of loop()
+    uint64_t spent = clock.now() - start;
+    worst = spent > worst ? spent : worst;
+    total += spent;
+  }
+  clock.uninstall();
+
+  char label[64];
+  snprintf(label, sizeof(label), "%s, longest loop()", name);
+  benchReport(label, (double)worst, "us");
+  snprintf(label, sizeof(label), "%s, mean loop()", name);
+  benchReport(label, (double)total / passes, "us");
+}
+
+int main(int argc, char** argv) {
+  unsigned long n = benchIterations(argc, argv, 100000);
+
+  measure("blocking getCurrentRegisters()", n, true);
+  measure("ProbeTask, one frame per poll()", n, false);
+
+  // CPU per poll() with nothing on the wire
+  drvSim sim;
+  drv motor(0, sim);
+  ProbeTask probe(&motor);
+  uint64_t start = benchNanos();
+  for (unsigned long i = 0; i < n; i++) {
+    if (probe.poll() != TASK_RUNNING) {
+      probe.restart();
+    }
+  }
+  benchReport("ProbeTask::poll() on this host", (double)(benchNanos() - start) / n, "ns");
+  return 0;
+}
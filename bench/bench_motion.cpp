@@ -0,0 +1,29 @@
+/*
+  bench_motion.cpp - CPU cost of MotionPlanner::step() per step
+
+  One long move at MOTION_MAX_RATE, so most steps are cruise and both ramps
+  are included. drvStepper writes the IN pins through the host shim.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvMotion.h>
+#include "bench.h"
+
+int main(int argc, char** argv) {
+  unsigned long n = benchIterations(argc, argv, 200000);
+  drvSim sim;
+  drv motor(0, sim);
+  drvStepper coils(motor, 2, 3, 4, 5, true);
+  MotionPlanner planner(coils);
+  planner.queue(n, MOTION_MAX_RATE, 60000);
+
+  unsigned long steps = 0;
+  uint64_t start = benchNanos();
+  while (planner.step()) {
+    steps++;
+  }
+  benchReport("MotionPlanner::step()", (double)(benchNanos() - start) / steps, "ns/step");
+  return 0;
+}
@@ -0,0 +1,60 @@
+/*
+  bench_softspi.cpp - frame cost of the transports drv can use
+
+  On the host the bit banged transports run against the Arduino shim, whose
+  pin calls do nothing and whose MISO reads 0, so their figures are the bit
+  loop and call overhead only, not pin timing. What it shows is what each
+  transport costs per frame on the same CPU:
+
+    SoftSpiTransport       pins chosen at runtime (digitalWrite off AVR)
+    FastSoftSpi<...>       pins as template parameters
+    SimSpidev              the spidev transfer building, ioctl answered by a drvSim
+
+  On an ATmega328P the pin accesses are the cost: FastSoftSpi is one
+  sbi / cbi / sbic each, SoftSpiTransport a load-modify-store through the
+  port pointer. Measure those on a board with the same loop.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvSpidev.h>
+#include "bench.h"
+
+static double perFrame(drvTransport& bus, unsigned long n) {
+  bus.begin(0);
+  volatile unsigned int sink = 0;
+  uint64_t start = benchNanos();
+  for (unsigned long i = 0; i < n; i++) {
+    bus.open(0);
+    sink = sink + bus.transfer16(0x8000 | ((i & 0x7) << 12));
+    bus.close(0);
+  }
+  return (double)(benchNanos() - start) / n;
+}
+
+int main(int argc, char** argv) {
+  unsigned long n = benchIterations(argc, argv, 1000000);
+
+  SoftSpiTransport soft(7, 8, 9);
+  benchReport("SoftSpiTransport", perFrame(soft, n), "ns/frame");
+
+  FastSoftSpi<7, 8, 9> fast;
+  benchReport("FastSoftSpi<7, 8, 9>", perFrame(fast, n), "ns/frame");
+
+  drvSim sim;
+  SimSpidev spidev(sim);
+  benchReport("SimSpidev", perFrame(spidev, n), "ns/frame");
+
+  // the drv layer on top: one read() through each
+  drv softMotor(7, 8, 9, 0);
+  uint64_t start = benchNanos();
+  for (unsigned long i = 0; i < n; i++) {
+    softMotor.read(i & 0x7);
+  }
+  benchReport("drv::read() on drv(out, in, clk, select)", (double)(benchNanos() - start) / n, "ns");
+
+  printf("sizeof(drv): %u bytes, sizeof(SoftSpiTransport): %u bytes\n",
+         (unsigned)sizeof(drv), (unsigned)sizeof(SoftSpiTransport));
+  return 0;
+}
@@ -0,0 +1,37 @@
+/*
+  bench_transfer.cpp - CPU cost per frame on the spidev path, single vs batched
+
+  Against SimSpidev, so this is the driver and transfer building only, not
+  the wire or the kernel.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvSpidev.h>
+#include "bench.h"
+
+int main(int argc, char** argv) {
+  unsigned long n = benchIterations(argc, argv, 200000);
+  drvSim sim;
+  SimSpidev bus(sim);
+  drv motor(0, bus);
+
+  uint64_t start = benchNanos();
+  for (unsigned long i = 0; i < n; i++) {
+    motor.read(motor.TORQUE);
+  }
+  benchReport("read(), one frame per ioctl", (double)(benchNanos() - start) / n, "ns/frame");
+
+  unsigned int frames[8];
+  unsigned int responses[8];
+  for (uint8_t i = 0; i < 8; i++) {
+    frames[i] = 0x8000 | ((i & 0x7) << 12);
+  }
+  start = benchNanos();
+  for (unsigned long i = 0; i < n / 8; i++) {
+    motor.transfer(frames, responses, 8);
+  }
+  benchReport("transfer(), 8 frames per ioctl", (double)(benchNanos() - start) / (n / 8 * 8), "ns/frame");
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+  Sequencer.cpp - transaction sequencer for a shared DRV8704 SPI bus
+
+  ** see Sequencer.h for usage **
+
+*/
+#include <Arduino.h>
+#include <Sequencer.h>
+
+// 8 bit indices are single instructions on every target, the builtins add the
+// ordering so a slot is fully written before its index is published
+#define SEQ_LOAD(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define SEQ_STORE(x, v) __atomic_store_n(&(x), (uint8_t)(v), __ATOMIC_RELEASE)
+
+Sequencer::Sequencer() {
+  for (uint8_t i = 0; i < SEQ_CLASSES; i++) {
+    queues[i].head = 0;
+    queues[i].serviced = 0;
+    queues[i].retired = 0;
+    highWater[i] = 0;
+  }
+}
+
+int Sequencer::submit(drv* device, unsigned int frame, uint8_t priority) {
+  if (priority >= SEQ_CLASSES) {
+    return -1;
+  }
+  Queue& q = queues[priority];
+
+  uint8_t head = q.head; // only this context writes head
+  uint8_t used = (uint8_t)(head - SEQ_LOAD(q.retired));
+  if (used >= SEQ_DEPTH) {
+    return -1; // full
+  }
+
+  Slot& slot = q.slots[head & (SEQ_DEPTH - 1)];
+  slot.device = device;
+  slot.frame = frame;
+  SEQ_STORE(q.head, head + 1);
+
+  if (used + 1 > highWater[priority]) {
+    highWater[priority] = used + 1;
+  }
+
+  return head;
+}
+
+int Sequencer::submitRead(drv* device, unsigned int address, uint8_t priority) {
+  return submit(device, (address << 12) | 0x8000, priority);
+}
+
+int Sequencer::submitWrite(drv* device, unsigned int address, unsigned int value, uint8_t priority) {
+  return submit(device, ((address << 12) & ~0x8000) | (value & 0xFFF), priority);
+}
+
+bool Sequencer::poll(uint8_t priority, int ticket, unsigned int* response) {
+  if (priority >= SEQ_CLASSES || ticket < 0) {
+    return false;
+  }
+  Queue& q = queues[priority];
+  uint8_t t = (uint8_t)ticket;
+
+  // done once the owner moved past it
+  uint8_t ahead = (uint8_t)(SEQ_LOAD(q.serviced) - t);
+  if (ahead == 0 || ahead > SEQ_DEPTH) {
+    return false;
+  }
+
+  if (response) {
+    *response = q.slots[t & (SEQ_DEPTH - 1)].response;
+  }
+
+  // release everything up to this ticket
+  if ((uint8_t)(t + 1 - q.retired) <= SEQ_DEPTH) {
+    SEQ_STORE(q.retired, t + 1);
+  }
+
+  return true;
+}
+
+unsigned int Sequencer::service(uint8_t max) {
+  unsigned int sent = 0;
+
+  while (sent < max) {
+    // pick the highest priority class with work queued
+    Queue* q = 0;
+    for (uint8_t i = 0; i < SEQ_CLASSES; i++) {
+      if (queues[i].serviced != SEQ_LOAD(queues[i].head)) {
+        q = &queues[i];
+        break;
+      }
+    }
+    if (!q) {
+      break; // nothing pending
+    }
+
+    uint8_t index = q->serviced; // only the owner writes serviced
+    Slot& slot = q->slots[index & (SEQ_DEPTH - 1)];
+    slot.response = slot.device->transfer(slot.frame);
+    SEQ_STORE(q->serviced, index + 1);
+    sent++;
+  }
+
+  return sent;
+}
+
+uint8_t Sequencer::pending(uint8_t priority) {
+  if (priority >= SEQ_CLASSES) {
+    return 0;
+  }
+  return (uint8_t)(SEQ_LOAD(queues[priority].head) - SEQ_LOAD(queues[priority].serviced));
+}
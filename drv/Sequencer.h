@@ -0,0 +1,116 @@
+/*
+  Sequencer.h - transaction sequencer for a shared DRV8704 SPI bus
+
+  Serializes bus access when a fault ISR, a control timer and loop() all talk
+  to the same drv. Contexts never touch the bus themselves, they submit frames
+  into a per priority queue and one owner context (usually loop()) services
+  them, so SCS is only ever asserted by one context.
+
+  Priority classes (highest first):
+    SEQ_FAULT      - fault ISR
+    SEQ_CONTROL    - control timer
+    SEQ_CONFIG     - configuration from loop()
+    SEQ_DIAG       - diagnostics from loop()
+
+  Each class queue is single producer / single consumer and lock free, so each
+  class must be fed by only one context. No interrupts are masked.
+
+  drv itself takes no lock: read(), write(), transfer(), the setters and the
+  drvTask tasks clock frames and update the shadow from whichever context
+  calls them. Once a drv is shared through a Sequencer, only the owner
+  context may call those; every other context goes through submit*().
+  tests/test_sequencer_threads.cpp runs this with one thread per class.
+
+  Usage:
+
+    drv motor(10);
+    Sequencer bus;
+
+    ISR(...) {
+      faultTicket = bus.submitRead(&motor, motor.STATUS, SEQ_FAULT);
+    }
+
+    void loop() {
+      bus.service(SEQ_ALL);
+      unsigned int status;
+      if (bus.poll(SEQ_FAULT, faultTicket, &status)) { ... }
+    }
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+
+// priority classes, lower number is serviced first
+#define SEQ_FAULT 0
+#define SEQ_CONTROL 1
+#define SEQ_CONFIG 2
+#define SEQ_DIAG 3
+#define SEQ_CLASSES 4
+
+// slots per class, must be a power of two no larger than 128
+#define SEQ_DEPTH 8
+
+// pass to service() to drain every queue
+#define SEQ_ALL 0xFF
+
+class Sequencer {
+    public:
+
+        Sequencer();
+
+        /*
+        queues a raw frame for device in the given priority class
+        returns a ticket for poll(), or -1 if that class is full
+        */
+        int submit(drv* device, unsigned int frame, uint8_t priority);
+
+        /*
+        queues a register read / write, same as submit()
+        */
+        int submitRead(drv* device, unsigned int address, uint8_t priority);
+
+        int submitWrite(drv* device, unsigned int address, unsigned int value, uint8_t priority);
+
+        /*
+        checks a ticket from the submitting context
+        returns true once the frame went out, response gets the word clocked back.
+        completed slots up to and including ticket are released for reuse,
+        so poll tickets of one class in the order they were submitted
+        */
+        bool poll(uint8_t priority, int ticket, unsigned int* response);
+
+        /*
+        owner context only: clocks out up to max queued frames, always taking
+        the highest priority pending frame next
+        returns the number of frames sent
+        */
+        unsigned int service(uint8_t max);
+
+        /*
+        number of frames waiting in a class
+        */
+        uint8_t pending(uint8_t priority);
+
+        /*
+        highest number of frames ever waiting in a class (for sizing SEQ_DEPTH)
+        */
+        uint8_t highWater[SEQ_CLASSES];
+
+    private:
+
+        struct Slot {
+            drv* device;
+            unsigned int frame;
+            unsigned int response;
+        };
+
+        struct Queue {
+            Slot slots[SEQ_DEPTH];
+            uint8_t head;       // next free slot, written by producer
+            uint8_t serviced;   // next slot to send, written by owner
+            uint8_t retired;    // next slot to release, written by producer
+        };
+
+        Queue queues[SEQ_CLASSES];
+};
@@ -22,10 +22,10 @@
   ** see drv.h for full doc **
 
 */
-#include <SPI.h>
 #include <Arduino.h>
 #include <drv.h>
 #include <Logger.h>
+#include <drvTask.h>
 
 // initialize logging object
 Logger logger("DRV8704", "info");
@@ -39,42 +39,201 @@ const int DECAY = 0x4;
 const int DRIVE = 0x6;
 const int STATUS = 0x7;
 
-// constructor
+// timing for drvStats, compiles away without DRV_STATS; setters end every
+// path in STAT_DONE, invalid input included (counted as an error)
+#if DRV_STATS
+#define STAT_START unsigned long statStart = micros()
+#define STAT_DONE(op, ok) stats.record(op, micros() - statStart, ok)
+#else
+#define STAT_START
+#define STAT_DONE(op, ok) (ok)
+#endif
+
+// default reg values
+static const unsigned int defaultRegs[] = {
+    0x301, // B001100000001  CTRL
+    0x0FF, // B000011111111  TORQUE
+    0x130, // B000100110000  OFF
+    0x080, // B000010000000  BLANK
+    0x010, // B000000010000  DECAY
+    0x000, // B000000000000  RESERVED register (unused)
+    0xFA5, // B111110100101  DRIVE
+    0x000, // B000000000000  STATUS
+};
+
+// shared by every drv on the SPI peripheral
+#if defined(ARDUINO)
+static HardwareSpiTransport hardwareSpi;
+#else
+static SpidevTransport hardwareSpi; // one device per select, /dev/spidev0.<select>
+#endif
+
+// constructors
 drv::drv(int select) {
+  softSpi = 0;
+  init(select, &hardwareSpi);
+}
+
+drv::drv(int out, int in, int clk, int select) {
+  // allocated here so the other constructors do not carry one
+  softSpi = new SoftSpiTransport(out, in, clk);
+  init(select, softSpi);
+  _MOSI = out;
+  _MISO = in;
+  _SCLK = clk;
+}
+
+drv::drv(int select, drvTransport& bus) {
+  softSpi = 0;
+  init(select, &bus);
+}
+
+drv::~drv() {
+  delete softSpi;
+}
 
-  // pins
+void drv::init(int select, drvTransport* bus) {
+
+  // pins (_MOSI/_MISO/_SCLK only used for software SPI)
+  _MOSI = -1;
+  _MISO = -1;
+  _SCLK = -1;
   _SCS = select;
+  transport = bus;
+  started = false; // pins are set up on the first frame, after Arduino's init()
+  activeProfile = PROFILE_NONE;
+  trusted = 0;
+  healthy = true;
+  lastResponse = 0;
+  link.responses = 0;
+  link.stuckHigh = 0;
+  link.stuckLow = 0;
+  link.badBits = 0;
+  link.mismatches = 0;
+
+  for (int i = 0; i < 8; i++) {
+    initRegs[i] = defaultRegs[i];
+    currentRegisterValues[i] = defaultRegs[i]; // updated with getCurrentRegisters
+  }
 
-  // updated with currentRegisterValues
-  unsigned int currentRegisterValues[8];
-
-  unsigned int initRegs[] = {
-      0x301, // B001100000001  CTRL
-      0x0FF, // B000011111111  TORQUE
-      0x130, // B000100110000  OFF
-      0x080, // B000010000000  BLANK
-      0x010, // B000000010000  DECAY
-      0x000, // B000000000000  RESERVED register (unused)
-      0xFA5, // B111110100101  DRIVE
-      0x000, // B000000000000  STATUS
-  };    
-
-  bool faults[] = {0, 0, 0, 0, 0, 0};
-    
-  
+  for (int i = 0; i < 6; i++) {
+    faults[i] = false;
+  }
 }
 
 /*
 PUBLIC FUNCTIONS
 */
 void drv::open() {
-  digitalWrite(_SCS, HIGH);
-  SPI.beginTransaction(SPISettings(140000, MSBFIRST, SPI_MODE0));  
+  if (!started) {
+    transport->begin(_SCS);
+    started = true;
+  }
+  transport->open(_SCS);
 }
 
 void drv::close() {
-  SPI.endTransaction();
-  digitalWrite(_SCS, LOW);
+  transport->close(_SCS);
+}
+
+unsigned int drv::transfer(unsigned int packet) {
+  unsigned int response;
+  open();
+  response = transport->transfer16(packet);
+  close();
+  checkResponse(packet, response);
+
+  return response;
+}
+
+void drv::transfer(const unsigned int* packets, unsigned int* responses, uint8_t count) {
+  if (!started) {
+    transport->begin(_SCS);
+    started = true;
+  }
+  unsigned int scratch[8];
+  for (uint8_t done = 0; done < count; ) {
+    // responses are always captured, for the link check
+    uint8_t n = count - done < 8 ? count - done : 8;
+    unsigned int* into = responses ? responses + done : scratch;
+    transport->transferFrames(_SCS, packets + done, into, n);
+    for (uint8_t i = 0; i < n; i++) {
+      checkResponse(packets[done + i], into[i]);
+    }
+    done += n;
+  }
+}
+
+void drv::checkResponse(unsigned int frame, unsigned int response) {
+  uint8_t address = (frame >> 12) & 0x7;
+  if (!(frame & 0x8000)) {
+    // every write frame, also raw ones from the Sequencer or writeFrames(),
+    // moves the shadow, so a later setter or update() starts from it
+    currentRegisterValues[address] = frame & ~0xF000;
+    trusted &= ~(1 << address); // not read back yet
+    activeProfile = PROFILE_NONE;
+  }
+  link.responses++;
+  lastResponse = response;
+  healthy = false;
+
+  if (response == 0xFFFF) {
+    link.stuckHigh++; // nothing drove MISO
+  } else if (!(frame & 0x8000)) {
+    if (response != 0) {
+      link.badBits++; // the part shifts out zeros during a write
+    } else {
+      healthy = true;
+    }
+  } else if (response & 0xF000) {
+    link.badBits++; // a read answers in bits 11-0 only
+  } else if (response == 0 && address != (uint8_t)STATUS && (trusted & (1 << address))
+             && currentRegisterValues[address] != 0) {
+    link.stuckLow++;
+  } else {
+    healthy = true;
+  }
+
+  if (!healthy) {
+    trusted = 0; // take nothing from the shadow until it is read again
+  }
+}
+
+unsigned int drv::shadowRead(unsigned int address) {
+  if (trusted & (1 << address)) {
+    return currentRegisterValues[address];
+  }
+  return read(address);
+}
+
+int drv::writeVerified(const unsigned int* frames, uint8_t count) {
+  unsigned int batch[2 * DRV_VERIFY_MAX];
+  unsigned int responses[2 * DRV_VERIFY_MAX];
+  if (count > DRV_VERIFY_MAX) {
+    count = DRV_VERIFY_MAX;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    batch[i] = frames[i] & ~0x8000;
+    batch[count + i] = 0x8000 | (frames[i] & 0x7000);
+  }
+  transfer(batch, responses, 2 * count);
+
+  int failed = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t address = (frames[i] >> 12) & 0x7;
+    unsigned int value = responses[count + i] & ~0xF000;
+    currentRegisterValues[address] = value;
+    if (value == (frames[i] & 0x0FFF) && responses[count + i] != 0xFFFF) {
+      if (address != STATUS) {
+        trusted |= 1 << address;
+      }
+    } else {
+      trusted &= ~(1 << address);
+      link.mismatches++;
+      failed++;
+    }
+  }
+  return failed;
 }
 
 unsigned int drv::read(unsigned int address) {
@@ -86,12 +245,22 @@ unsigned int drv::read(unsigned int address) {
 
      Example:  data = spiReadReg(0x6);
     */ 
+    STAT_START;
     unsigned int value;
     address = address << 12; // allocate zeros for data
     address |= 0x8000; // set MSB to read (1)
-    open();
-    value = SPI.transfer16(address); // transfer read request, recieve data
-    close();
+    value = transfer(address); // transfer read request, recieve data
+    address = (address >> 12) & 0x7;
+    currentRegisterValues[address] = value & ~0xF000;
+    if (address == (unsigned int)STATUS) {
+      if (value & 0x020) {
+        trusted = 0; // UVLO, the registers may have reset
+        activeProfile = PROFILE_NONE; // and the profile deltas no longer apply
+      }
+    } else if (healthy) {
+      trusted |= 1 << address; // the shadow matches the device
+    }
+    (void)STAT_DONE(STAT_READ, value != 0xFFFF); // all ones: nothing drove MISO
     
     return value;
 }
@@ -107,14 +276,48 @@ void drv::write(unsigned int address, unsigned int value) {
   Example:  spiWriteReg(0x6, 0x0FF0);
 
   */
+  STAT_START;
   unsigned int packet=0;
 
   address = address << 12; // build packet skelleton
   address &= ~0x8000; // set MSB to write (0)
   packet = address | value;
-  open();  // open comms
-  SPI.transfer16(packet);
-  close(); // close
+  transfer(packet); // the shadow follows in checkResponse()
+  (void)STAT_DONE(STAT_WRITE, true);
+}
+
+bool drv::update(unsigned int address, unsigned int value) {
+  value &= ~0xF000;
+  if (currentRegisterValues[address & 0x7] == value) {
+    return false;
+  }
+  write(address, value);
+  return true;
+}
+
+void drv::writeFrames(const unsigned int* frames, uint8_t count) {
+  transfer(frames, 0, count); // the shadow follows in checkResponse()
+}
+
+void drv::loadTable(const uint16_t* table, uint8_t count) {
+  unsigned int frames[8];
+  while (count) {
+    uint8_t n = count > 8 ? 8 : count;
+    for (uint8_t i = 0; i < n; i++) {
+      frames[i] = pgm_read_word(table + i);
+    }
+    writeFrames(frames, n);
+    table += n;
+    count -= n;
+  }
+}
+
+bool drv::updateTorque(uint8_t value) {
+  return update(TORQUE, (currentRegisterValues[TORQUE] & 0xF00) | value);
+}
+
+bool drv::updateDecMode(uint8_t value) {
+  return update(DECAY, (currentRegisterValues[DECAY] & ~0x700) | ((value & 0x7) << 8));
 }
 
 void drv::setLogging(char* level) {
@@ -125,30 +328,179 @@ void drv::setLogging(char* level) {
   Serial.println(level);
 }
 
+void drv::getCurrentRegisters() {
+  ProbeTask probe(this);
+  if (probe.run() != TASK_DONE) {
+    logger.loge("register read: no response");
+  }
+}
+
+bool drv::saveConfig(drvConfigStore& store) {
+  drvConfigImage image;
+  for (int i = 0; i < DRV_CONFIG_REGS; i++) {
+    image.regs[i] = currentRegisterValues[i] & ~0xF000;
+  }
+  drvSealImage(image);
+
+  if (!store.save((const uint8_t*)&image, sizeof(image))) {
+    logger.loge("config save: store write failed");
+    return false;
+  }
+  return true;
+}
+
+int drv::restoreConfig(drvConfigStore& store) {
+  drvConfigImage image;
+  if (!store.load((uint8_t*)&image, sizeof(image)) || !drvCheckImage(image)) {
+    logger.loge("config restore: no valid image");
+    return -1;
+  }
+
+  // snapshot what the shadow cannot vouch for, then write only what
+  // differs with its readback in the same batch
+  readUntrusted();
+  unsigned int frames[DRV_CONFIG_REGS];
+
+  // ENBL is not part of the configuration, the bridge stays as it is
+  image.regs[CTRL] = (image.regs[CTRL] & ~0x001) | (currentRegisterValues[CTRL] & 0x001);
+
+  uint8_t changed = 0;
+  for (int i = 0; i < DRV_CONFIG_REGS; i++) {
+    if (i != 0x5 && currentRegisterValues[i] != image.regs[i]) {
+      frames[changed++] = (i << 12) | image.regs[i];
+    }
+  }
+  if (writeVerified(frames, changed) != 0) {
+    logger.loge("config restore: readback mismatch");
+    return -2;
+  }
+
+  LogLine line;
+  line.append("config restore: ").append((unsigned int)changed).append(" registers written");
+  logger.logi(line.str());
+  return changed;
+}
+
+void drv::readUntrusted() {
+  unsigned int frames[DRV_CONFIG_REGS];
+  unsigned int values[DRV_CONFIG_REGS];
+  uint8_t addresses[DRV_CONFIG_REGS];
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < DRV_CONFIG_REGS; i++) {
+    if (i != 0x5 && !(trusted & (1 << i))) { // skip RESERVED
+      addresses[n] = i;
+      frames[n++] = 0x8000 | (i << 12);
+    }
+  }
+  transfer(frames, values, n);
+  for (uint8_t k = 0; k < n; k++) {
+    uint8_t i = addresses[k];
+    currentRegisterValues[i] = values[k] & ~0xF000;
+    if (values[k] != 0xFFFF && !(values[k] & 0xF000)) {
+      trusted |= 1 << i;
+    }
+  }
+}
+
+bool drv::switchProfile(uint8_t id) {
+  if (id >= PROFILE_COUNT) {
+    logger.loge("profile switch: invalid input");
+    return false;
+  }
+
+  uint8_t delta = 0;
+  if (activeProfile < PROFILE_COUNT) {
+    delta = drvProfileDeltas[activeProfile][id];
+  } else {
+    // unknown state, diff against the shadow instead; registers it cannot
+    // vouch for (after an MCU reset, a raw write) are read first, CTRL too
+    // so its ENBL is the device's
+    readUntrusted();
+    for (uint8_t i = 0; i < PROFILE_REGS; i++) {
+      unsigned int mask = (i == CTRL) ? ~0xF001 : ~0xF000;
+      if (i != 0x5 && (currentRegisterValues[i] & mask) != (drvProfiles[id].regs[i] & mask)) {
+        delta |= 1 << i;
+      }
+    }
+  }
+
+  unsigned int frames[PROFILE_REGS];
+  uint8_t n = 0;
+  for (uint8_t i = 0; delta; i++, delta >>= 1) {
+    if (!(delta & 1)) {
+      continue;
+    }
+    unsigned int frame = drvProfileFrame(id, i);
+    if (i == CTRL) {
+      frame = (frame & ~0x001) | (currentRegisterValues[CTRL] & 0x001); // keep ENBL
+    }
+    frames[n++] = frame;
+  }
+  writeFrames(frames, n);
+
+  activeProfile = id;
+  return true;
+}
+
+void drv::regDiagnostic(int desiredRegs[]) {
+  unsigned int desired[8];
+  for (int i = 0; i < 7; i++) {
+    desired[i] = desiredRegs[i];
+  }
+  desired[7] = 0;
+
+  DiagnosticTask diagnostic(this, desired);
+  if (diagnostic.run() == TASK_DONE) {
+    logger.logi("register diagnostic: all registers match");
+    return;
+  }
+
+  const char* names[] = {"CTRL", "TORQUE", "OFF", "BLANK", "DECAY", "RESERVED", "DRIVE"};
+  char message[40];
+  for (int i = 0; i < 7; i++) {
+    if (diagnostic.mismatches & (1 << i)) {
+      strcpy(message, "register diagnostic: ");
+      strcat(message, names[i]);
+      strcat(message, " mismatch");
+      logger.loge(message);
+    }
+  }
+}
+
+void drv::dumpStats() {
+#if DRV_STATS
+  stats.dump(logger);
+#else
+  logger.loge("stats: built without DRV_STATS");
+#endif
+}
+
 // *** SETTERS ***
 
 bool drv::setHbridge(char* value) {
+  STAT_START;
   // cleat bits 16-13 from the read data (not used)
-  unsigned int current = read(CTRL) & ~0xF000;
+  unsigned int current = shadowRead(CTRL) & ~0xF000;
   unsigned int outgoing;
 
-  if (value == "off") {
+  if (strcmp(value, "off") == 0) {
     outgoing = current & ~0x001; // clear bit 0
-  } else if (value == "on") {
+  } else if (strcmp(value, "on") == 0) {
     outgoing = current | 0x001; // set bit 0
   } else {
     outgoing = current; // do nothing
     logger.loge("ENBL set: invalid input");
-    return false;
+    return STAT_DONE(STAT_HBRIDGE, false);
   }
 
   write(CTRL, outgoing);
 
-  return logger.logSet("CTRL", "ENBL", value, getHbridge() == value);
+  return logger.logSet("CTRL", "ENBL", value, STAT_DONE(STAT_HBRIDGE, strcmp(getHbridge(), value) == 0));
 }
 
 bool drv::setISGain(int value) {
-  unsigned int current = read(CTRL) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(CTRL) & ~0xF000;
   unsigned int outgoing;
 
   if (value == 5) {
@@ -164,16 +516,17 @@ bool drv::setISGain(int value) {
   } else {
     outgoing = current; // do nothing
     logger.loge("ISGAIN set: invalid input");
-    return false;
+    return STAT_DONE(STAT_ISGAIN, false);
   }
   
   write(CTRL, outgoing);
 
-  return logger.logSet("CTRL", "ISGAIN", value, getISGain() == value);
+  return logger.logSet("CTRL", "ISGAIN", value, STAT_DONE(STAT_ISGAIN, getISGain() == value));
 }
 
 bool drv::setDTime(int value) {
-  unsigned int current = read(CTRL) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(CTRL) & ~0xF000;
   unsigned int outgoing;
   
   if (value == 410) {
@@ -193,11 +546,12 @@ bool drv::setDTime(int value) {
 
   write(CTRL, outgoing);
 
-  return logger.logSet("CTRL", "DTIME", value, getDTime() == value);
+  return logger.logSet("CTRL", "DTIME", value, STAT_DONE(STAT_DTIME, getDTime() == value));
 }
 
 bool drv::setTorque(unsigned int value) {
-  unsigned int current = read(TORQUE) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(TORQUE) & ~0xF000;
   unsigned int outgoing;
 
   if(value <= 255 && value >= 0) {
@@ -206,15 +560,16 @@ bool drv::setTorque(unsigned int value) {
   } else {
     outgoing = current; // do nothing
     logger.loge("TORQUE set: invalid input");
-    return false;
+    return STAT_DONE(STAT_TORQUE, false);
   }
 
   write(TORQUE, outgoing);
-  return logger.logSet("TORQUE", "TORQUE", value, getTorque() == value);
+  return logger.logSet("TORQUE", "TORQUE", value, STAT_DONE(STAT_TORQUE, getTorque() == value));
 }
 
 bool drv::setTOff(unsigned int value) {
-  unsigned int current = read(OFF) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(OFF) & ~0xF000;
   unsigned int outgoing;
 
   if(value <= 255 && value >= 0) {
@@ -223,15 +578,16 @@ bool drv::setTOff(unsigned int value) {
   } else {
     outgoing = current; // do nothing
     logger.loge("TOFF set: invalid input");
-    return false;
+    return STAT_DONE(STAT_TOFF, false);
   }
   
   write(OFF, outgoing);
-  return logger.logSet("OFF", "TOFF", value, getTOff() == value);
+  return logger.logSet("OFF", "TOFF", value, STAT_DONE(STAT_TOFF, getTOff() == value));
 }
 
 bool drv::setTBlank(unsigned int value) {
-  unsigned int current = read(BLANK) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(BLANK) & ~0xF000;
   unsigned int outgoing;
 
   if(value <= 255 && value >= 0) {
@@ -240,15 +596,16 @@ bool drv::setTBlank(unsigned int value) {
   } else {
     outgoing = current; // do nothing
     logger.loge("TBLANK set: invalid input");
-    return false;
+    return STAT_DONE(STAT_TBLANK, false);
   }
   
   write(BLANK, outgoing);
-  return logger.logSet("BLANK", "TBLANK", value, getTBlank() == value);
+  return logger.logSet("BLANK", "TBLANK", value, STAT_DONE(STAT_TBLANK, getTBlank() == value));
 }
 
 bool drv::setTDecay(unsigned int value) {
-  unsigned int current = read(DECAY)  & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DECAY) & ~0xF000;
   unsigned int outgoing;
 
   if(value <= 255 && value >= 0) {
@@ -257,40 +614,42 @@ bool drv::setTDecay(unsigned int value) {
   } else {
     outgoing = current; // do nothing
     logger.loge("TDECAY set: invalid input");
-    return false;
+    return STAT_DONE(STAT_TDECAY, false);
   }
   
   write(DECAY, outgoing);
-  return logger.logSet("DECAY", "TDECAY", value, getTDecay() == value);
+  return logger.logSet("DECAY", "TDECAY", value, STAT_DONE(STAT_TDECAY, getTDecay() == value));
 }
 
 bool drv::setDecMode(char* value) {
-  unsigned int current = read(DECAY)  & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DECAY) & ~0xF000;
   unsigned int outgoing;
 
-  if(value == "slow") {
+  if(strcmp(value, "slow") == 0) {
     outgoing = current & ~0x700;// clear bits 10-8
-  } else if (value == "fast") {
+  } else if (strcmp(value, "fast") == 0) {
     outgoing = current & ~0x700; // clear bits 10-8
     outgoing |= 0x200; // set bit 9
-  } else if (value == "mixed") {
+  } else if (strcmp(value, "mixed") == 0) {
     outgoing = current & ~0x700; // clear bits 10-8
     outgoing |= 0x300; // set bits 9-8
-  } else if (value == "auto") {
+  } else if (strcmp(value, "auto") == 0) {
     outgoing = current & ~0x700; // clear bits 10-8
     outgoing |= 0x500; // set bits 10 and 8
   } else {
     outgoing = current; // do nothing
     logger.loge("DECMOD set: invalid input");
-    return false;
+    return STAT_DONE(STAT_DECMODE, false);
   }
 
   write(DECAY, outgoing);
-  return logger.logSet("DECAY", "DECMOD", value, getDecMode() == value);
+  return logger.logSet("DECAY", "DECMOD", value, STAT_DONE(STAT_DECMODE, strcmp(getDecMode(), value) == 0));
 }
 
 bool drv::setOCPThresh(int value) {
-  unsigned int current = read(DRIVE)  & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DRIVE) & ~0xF000;
   unsigned int outgoing;
 
   if (value == 250) {
@@ -306,15 +665,16 @@ bool drv::setOCPThresh(int value) {
   } else {
     outgoing = current;
     logger.loge("OCPTH set: invalid input");
-    return false;
+    return STAT_DONE(STAT_OCPTH, false);
   }
   
   write(DRIVE, outgoing);
-  return logger.logSet("DRIVE", "OCPTH", value, getOCPThresh() == value);
+  return logger.logSet("DRIVE", "OCPTH", value, STAT_DONE(STAT_OCPTH, getOCPThresh() == value));
 }
 
 bool drv::setOCPDeglitchTime(float value) {
-  unsigned int current = read(DRIVE) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DRIVE) & ~0xF000;
   unsigned int outgoing;
 
   if (value == 1.05) {
@@ -330,15 +690,16 @@ bool drv::setOCPDeglitchTime(float value) {
   } else {
     outgoing = current;
     logger.loge("OCPDEG set: invalid input");
-    return false;
+    return STAT_DONE(STAT_OCPDEG, false);
   }
 
   write(DRIVE, outgoing);
-  return logger.logSet("DRIVE", "OCPTH", value, getOCPDeglitchTime() == value);
+  return logger.logSet("DRIVE", "OCPTH", value, STAT_DONE(STAT_OCPDEG, getOCPDeglitchTime() == value));
 }
 
 bool drv::setTDriveN(int value) {
-  unsigned int current = read(DRIVE) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DRIVE) & ~0xF000;
   unsigned int outgoing;
 
   if (value == 263) {
@@ -354,15 +715,16 @@ bool drv::setTDriveN(int value) {
   } else {
     outgoing = current;
     logger.loge("TDRIVEN set: invalid input");
-    return false;
+    return STAT_DONE(STAT_TDRIVEN, false);
   }
 
   write(DRIVE, outgoing);
-  return logger.logSet("DRIVE", "TDRIVEN", value, getTDriveN() == value);
+  return logger.logSet("DRIVE", "TDRIVEN", value, STAT_DONE(STAT_TDRIVEN, getTDriveN() == value));
 }
 
 bool drv::setTDriveP(int value) {
-  unsigned int current = read(DRIVE) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DRIVE) & ~0xF000;
   unsigned int outgoing;
 
   if (value == 263) {
@@ -378,15 +740,16 @@ bool drv::setTDriveP(int value) {
   } else {
     outgoing = current;
     logger.loge("TDRIVEP set: invalid input");
-    return false;
+    return STAT_DONE(STAT_TDRIVEP, false);
   }
   
   write(DRIVE, outgoing);
-  return logger.logSet("DRIVE", "TDRIVEP", value, getTDriveP() == value);
+  return logger.logSet("DRIVE", "TDRIVEP", value, STAT_DONE(STAT_TDRIVEP, getTDriveP() == value));
 }
 
 bool drv::setIDriveN(int value) {
-  unsigned int current = read(DRIVE) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DRIVE) & ~0xF000;
   unsigned int outgoing;
 
   if (value == 100) {
@@ -402,15 +765,16 @@ bool drv::setIDriveN(int value) {
   } else {
     outgoing = current;
     logger.loge("IDRIVEN set: invalid input");
-    return false;
+    return STAT_DONE(STAT_IDRIVEN, false);
   }
 
   write(DRIVE, outgoing);
-  return logger.logSet("DRIVE", "IDRIVEN", value, getIDriveN() == value);
+  return logger.logSet("DRIVE", "IDRIVEN", value, STAT_DONE(STAT_IDRIVEN, getIDriveN() == value));
 }
 
 bool drv::setIDriveP(int value) {
-  unsigned int current = read(DRIVE) & ~0xF000;
+  STAT_START;
+  unsigned int current = shadowRead(DRIVE) & ~0xF000;
   unsigned int outgoing;
 
   if (value == 50) {
@@ -426,11 +790,11 @@ bool drv::setIDriveP(int value) {
   } else {
     outgoing = current;
     logger.loge("IDRIVEP set: invalid input");
-    return false;
+    return STAT_DONE(STAT_IDRIVEP, false);
   }
 
   write(DRIVE, outgoing);
-  return logger.logSet("DRIVE", "IDRIVEP", value, getIDriveP() == value);
+  return logger.logSet("DRIVE", "IDRIVEP", value, STAT_DONE(STAT_IDRIVEP, getIDriveP() == value));
 }
 
 // *** GETTERS ***
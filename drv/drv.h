@@ -24,12 +24,50 @@
 */
 #pragma once
 #include <Arduino.h>
-#include <SPI.h>
+#include <drvTransport.h>
+#if !defined(ARDUINO)
+#include <drvSpidev.h>
+#endif
+#include <drvConfig.h>
+#include <drvProfiles.h>
+#include <drvStats.h>
+
+// most write frames writeVerified() takes in one batch
+#define DRV_VERIFY_MAX 8
+
+/*
+what the response words said about the bus. A read answers in bits 11-0 and a
+write shifts out zeros, anything else is counted here
+*/
+struct drvLinkHealth {
+    unsigned long responses;   // response words checked
+    unsigned long stuckHigh;   // all ones: MISO floating or SCS not reaching the part
+    unsigned long stuckLow;    // all zeros from a register the shadow holds nonzero
+    unsigned long badBits;     // bits set where the part drives zeros
+    unsigned long mismatches;  // writeVerified registers that read back different
+};
 
 class drv {
     public:
         
+        /*
+        DRV8704 on the SPI peripheral, select is the SCS pin
+        (Linux: the spidev chip select, /dev/spidev0.<select>)
+        */
+        drv(int select);
+
+        /*
+        DRV8704 on bit banged SPI using any free pins (see drvTransport.h),
+        the SoftSpiTransport is allocated with new once, here
+        */
         drv(int out, int in, int clk, int select);
+
+        /*
+        DRV8704 on any transport, e.g. FastSoftSpi<MOSI, MISO, SCLK>
+        */
+        drv(int select, drvTransport& bus);
+
+        ~drv();
         
         // pins
         int _MOSI;
@@ -38,7 +76,7 @@ class drv {
         int _SCS;
 
         // faults
-        bool faults[];
+        bool faults[6];
         
         
         // register addresses
@@ -50,10 +88,26 @@ class drv {
         const int DRIVE = 0x6;
         const int STATUS = 0x7;
 
+        // shadow of the device, kept up to date by every read() and every
+        // write frame that goes through transfer()
         unsigned int currentRegisterValues[8];
 
+        drvTransport* transport;
+
+        // response word of the last frame, and the link checks on all of them
+        unsigned int lastResponse;
+        drvLinkHealth link;
+
+#if DRV_STATS
+        // call counts, errors and latency histograms (see drvStats.h)
+        drvStats stats;
+#endif
+
+        // profile last loaded by switchProfile, PROFILE_NONE once write() changed anything
+        uint8_t activeProfile;
+
         // Default reg values
-        unsigned int initRegs[];
+        unsigned int initRegs[8];
 
         // functions 
         
@@ -67,6 +121,28 @@ class drv {
         */
         void close();
         
+        /*
+        clocks one raw 16 bit frame with SCS asserted, returns the response word.
+        read() and write() are built on this; the Sequencer calls it directly.
+        A write frame updates the shadow and marks the register not read back.
+        Neither this nor anything built on it is reentrant: with a Sequencer
+        in use only its owner context calls them (see Sequencer.h)
+        */
+        unsigned int transfer(unsigned int packet);
+
+        /*
+        clocks count raw frames, SCS released between them, in as few driver
+        calls as the transport allows (one ioctl on spidev). responses may be 0
+        */
+        void transfer(const unsigned int* packets, unsigned int* responses, uint8_t count);
+
+        /*
+        writes up to DRV_VERIFY_MAX raw write frames and reads each register
+        back, all in one transfer() batch (2 * count frames, one ioctl on spidev)
+        returns the number of registers that did not read back as written
+        */
+        int writeVerified(const unsigned int* frames, uint8_t count);
+
         /*
         reads from given address
         */
@@ -77,20 +153,82 @@ class drv {
         returns true if successful
         */
         void write(unsigned int address, unsigned int value);
+
+        /*
+        cheap write path for control loops: one write frame, no read or readback,
+        and no frame at all if the shadow already holds value
+        returns true if a frame was sent
+        */
+        bool update(unsigned int address, unsigned int value);
+
+        /*
+        sends count ready made write frames (address << 12 | value) in one
+        transfer() batch, no encoding and no readback; the shadow follows
+        */
+        void writeFrames(const unsigned int* frames, uint8_t count);
+
+        /*
+        streams a frame table from flash, e.g. one made by DRV_BUILD_TABLE
+        (drvBuild.h), through writeFrames()
+        */
+        void loadTable(const uint16_t* table, uint8_t count);
+
+        /*
+        sets bits 7-0 of TORQUE through update(), keeping the rest of the shadow
+        */
+        bool updateTorque(uint8_t value);
+
+        /*
+        sets DECMODE through update(), keeping TDECAY from the shadow
+        value: DECMODE bit pattern, 0 slow, 2 fast, 3 mixed, 5 auto
+        */
+        bool updateDecMode(uint8_t value);
         
         /*
         sets logging level for DRV logger object (see Logger.h)
         */
         void setLogging(char* level);
+
+        /*
+        logs the per operation stats (only with DRV_STATS, see drvStats.h)
+        */
+        void dumpStats();
         
         /*
         reads all registers and stores in currentRegisterValues
+        blocking, see ProbeTask in drvTask.h for the non blocking version
         */
         void getCurrentRegisters();
 
+        /*
+        stores CTRL..DRIVE from currentRegisterValues in store (see drvConfig.h)
+        returns true if successful
+        */
+        bool saveConfig(drvConfigStore& store);
+
+        /*
+        loads an image saved by saveConfig, reads the registers the shadow
+        cannot vouch for and writes only the ones that differ (writeVerified).
+        ENBL is left as the device has it, saved on or not
+        returns the number of registers written, -1 if store holds no valid
+        image, -2 if a written register did not read back
+        */
+        int restoreConfig(drvConfigStore& store);
+
+        /*
+        loads a profile from drvProfiles.h (PROFILE_HOLD/RUN/BRAKE)
+        only writes the registers that differ from the active profile, no reads;
+        with no active profile it diffs against the shadow, reading the
+        registers not read back since their last write in one batch first
+        returns false for an unknown profile
+        */
+        bool switchProfile(uint8_t id);
+
         /*
         confirms that all Regs have desired values
-        desiredRegs[]: array with 7 entries each with 12 bit values (one for each reg)
+        desiredRegs[]: array with 7 entries each with 12 bit values (one for each reg),
+            indexed by register address (entry 5 RESERVED is ignored)
+        blocking, see DiagnosticTask in drvTask.h for the non blocking version
         */
         void regDiagnostic(int desiredRegs[]);
 
@@ -286,6 +424,22 @@ class drv {
         */
         void clearFault(int value);
 
+    private:
+
+        SoftSpiTransport* softSpi;  // only for drv(out, in, clk, select)
+        bool started;
+
+        // registers whose shadow was read back healthy since the last write;
+        // setters modify those without reading them first (STATUS never)
+        uint8_t trusted;
+        bool healthy;   // last response passed the link checks
+
+        void init(int select, drvTransport* bus);
+        void checkResponse(unsigned int frame, unsigned int response);
+        unsigned int shadowRead(unsigned int address);
+
+        // reads the untrusted CTRL..DRIVE registers in one transfer() batch
+        void readUntrusted();
         
 };
 
@@ -0,0 +1,37 @@
+/*
+  drvAdc.h - where ISENSE samples come from
+
+  The current loop, tuner and stall detector read the DRV8704 ISENSE output
+  through a drvAdc, so they work the same on an analog pin, an external ADC
+  or a simulated motor (drvPlant.h).
+
+  Usage:
+
+    AnalogPinAdc isense(A0);
+    uint16_t counts = isense.sample();
+
+*/
+#pragma once
+#include <Arduino.h>
+
+class drvAdc {
+    public:
+        /*
+        one ISENSE reading in ADC counts
+        */
+        virtual uint16_t sample() = 0;
+};
+
+class AnalogPinAdc : public drvAdc {
+    public:
+        AnalogPinAdc(int pin) {
+            _PIN = pin;
+        }
+
+        uint16_t sample() {
+            return analogRead(_PIN);
+        }
+
+    private:
+        int _PIN;
+};
@@ -0,0 +1,240 @@
+/*
+  drvBuild.h - register configurations checked and encoded at compile time
+
+  drvBuild collects the settings the setters take, in the same units (ISGAIN
+  5/10/20/40, DTIME ns, OCPDEG ns as 1050/2100/4200/8400 instead of a float,
+  ...), starting from the power on values. Every step is constexpr, so a
+  configuration held in a constexpr variable is fully encoded by the
+  compiler. DRV_BUILD_TABLE() then static_asserts each field and the
+  constraints between them:
+
+    - blanking (TBLANK * 21 ns, at least 1 us) shorter than the off time
+      ((TOFF + 1) * 525 ns), or the chopper never sees the current settle
+    - in mixed / auto decay TDECAY no longer than TOFF, the fast part of the
+      decay has to fit inside the off time
+    - with limit(mA, mOhm) set, the trip current from TORQUE and ISGAIN
+      (2.75 V * TORQUE / 256 / (ISGAIN * Rsense)) within the limit
+
+  and emits the write frames as a PROGMEM table. drv::loadTable() streams it
+  with no validation, encoding or float compares at run time. CTRL comes last
+  so the bridges are only enabled once the rest is in place.
+
+  Usage (at file scope):
+
+    constexpr drvBuild quiet = drvBuild()
+        .isGain(20).torque(0x80).limit(1500, 50)  // 1.5 A motor, 50 mOhm
+        .tOff(0x30).tBlank(0x80)
+        .decMode(DECMODE_MIXED).tDecay(0x10)
+        .ocpDeglitch(2100)
+        .enable(true);
+    DRV_BUILD_TABLE(quietFrames, quiet);
+
+    void setup() {
+      motor.loadTable(quietFrames, DRV_BUILD_FRAMES);
+    }
+
+  A bad value stops the build, e.g. "TBLANK must be shorter than TOFF".
+
+*/
+#pragma once
+#include <Arduino.h>
+
+// frames in a table: TORQUE, OFF, BLANK, DECAY, DRIVE, CTRL
+#define DRV_BUILD_FRAMES 6
+
+// DECMODE bit patterns, as in drvCurrent.h
+#ifndef DECMODE_SLOW
+#define DECMODE_SLOW 0
+#define DECMODE_FAST 2
+#define DECMODE_MIXED 3
+#define DECMODE_AUTO 5
+#endif
+
+// drvBuild::errors() bits
+#define BUILD_ISGAIN 0x0001
+#define BUILD_DTIME 0x0002
+#define BUILD_TORQUE 0x0004
+#define BUILD_TOFF 0x0008
+#define BUILD_TBLANK 0x0010
+#define BUILD_TDECAY 0x0020
+#define BUILD_DECMODE 0x0040
+#define BUILD_OCPTH 0x0080
+#define BUILD_OCPDEG 0x0100
+#define BUILD_TDRIVEN 0x0200
+#define BUILD_TDRIVEP 0x0400
+#define BUILD_IDRIVEN 0x0800
+#define BUILD_IDRIVEP 0x1000
+#define BUILD_BLANK_OFF 0x2000
+#define BUILD_DECAY_OFF 0x4000
+#define BUILD_CURRENT 0x8000
+
+class drvBuild {
+    public:
+
+        constexpr drvBuild() : drvBuild(0x301, 0x0FF, 0x130, 0x080, 0x010, 0xFA5, 0, 0, 0) {}
+
+        // CTRL
+        constexpr drvBuild enable(bool on) const {
+            return drvBuild((ctrl & ~0x001) | (on ? 0x001 : 0), torqueReg, off, blank, decay, drive, checks, limitMilliamps, rsenseMilliohms);
+        }
+        constexpr drvBuild isGain(unsigned int gain) const {
+            return field(0, 0x300, 8, code(gain, 5, 10, 20, 40), BUILD_ISGAIN);
+        }
+        constexpr drvBuild dTime(unsigned int ns) const {
+            return field(0, 0xC00, 10, code(ns, 410, 460, 670, 880), BUILD_DTIME);
+        }
+
+        // TORQUE, OFF, BLANK, DECAY
+        constexpr drvBuild torque(unsigned int value) const {
+            return field(1, 0x0FF, 0, value, BUILD_TORQUE);
+        }
+        constexpr drvBuild tOff(unsigned int value) const {
+            return field(2, 0x0FF, 0, value, BUILD_TOFF);
+        }
+        constexpr drvBuild tBlank(unsigned int value) const {
+            return field(3, 0x0FF, 0, value, BUILD_TBLANK);
+        }
+        constexpr drvBuild tDecay(unsigned int value) const {
+            return field(4, 0x0FF, 0, value, BUILD_TDECAY);
+        }
+        constexpr drvBuild decMode(unsigned int mode) const {
+            return field(4, 0x700, 8, (mode == 0 || mode == 2 || mode == 3 || mode == 5) ? mode : 8, BUILD_DECMODE);
+        }
+
+        // DRIVE
+        constexpr drvBuild ocpThresh(unsigned int mv) const {
+            return field(6, 0x003, 0, code(mv, 250, 500, 750, 1000), BUILD_OCPTH);
+        }
+        constexpr drvBuild ocpDeglitch(unsigned int ns) const {
+            return field(6, 0x00C, 2, code(ns, 1050, 2100, 4200, 8400), BUILD_OCPDEG);
+        }
+        constexpr drvBuild tDriveN(unsigned int ns) const {
+            return field(6, 0x030, 4, code(ns, 263, 525, 1050, 2100), BUILD_TDRIVEN);
+        }
+        constexpr drvBuild tDriveP(unsigned int ns) const {
+            return field(6, 0x0C0, 6, code(ns, 263, 525, 1050, 2100), BUILD_TDRIVEP);
+        }
+        constexpr drvBuild iDriveN(unsigned int ma) const {
+            return field(6, 0x300, 8, code(ma, 100, 200, 300, 400), BUILD_IDRIVEN);
+        }
+        constexpr drvBuild iDriveP(unsigned int ma) const {
+            return field(6, 0xC00, 10, code(ma, 50, 100, 150, 200), BUILD_IDRIVEP);
+        }
+
+        /*
+        the trip current may not exceed milliamps with a sense resistor of milliohms
+        */
+        constexpr drvBuild limit(unsigned int milliamps, unsigned int milliohms) const {
+            return drvBuild(ctrl, torqueReg, off, blank, decay, drive, checks, milliamps, milliohms);
+        }
+
+        /*
+        register value by address (CTRL 0 .. DRIVE 6, RESERVED reads 0)
+        */
+        constexpr unsigned int reg(uint8_t address) const {
+            return address == 0 ? ctrl : address == 1 ? torqueReg : address == 2 ? off
+                 : address == 3 ? blank : address == 4 ? decay : address == 6 ? drive : 0;
+        }
+
+        /*
+        write frame i of the table, CTRL last
+        */
+        constexpr unsigned int frame(uint8_t i) const {
+            return ((unsigned int)(i < 4 ? i + 1 : i == 4 ? 6 : 0) << 12) | reg(i < 4 ? i + 1 : i == 4 ? 6 : 0);
+        }
+
+        // chopper times, ns
+        constexpr unsigned long offNs() const {
+            return ((off & 0x0FF) + 1UL) * 525;
+        }
+        constexpr unsigned long blankNs() const {
+            return 21UL * (blank & 0x0FF) < 1000 ? 1000 : 21UL * (blank & 0x0FF);
+        }
+
+        /*
+        trip current in mA for the limit's sense resistor (0 without limit())
+        */
+        constexpr unsigned long tripMilliamps() const {
+            return rsenseMilliohms ? 2750000UL * (torqueReg & 0x0FF) / (256UL * gain() * rsenseMilliohms) : 0;
+        }
+
+        /*
+        BUILD_ bits of everything wrong with this configuration, 0 if it is good
+        */
+        constexpr unsigned int errors() const {
+            return checks
+                | (blankNs() >= offNs() ? BUILD_BLANK_OFF : 0)
+                | ((mode() == 3 || mode() == 5) && (decay & 0x0FF) > (off & 0x0FF) ? BUILD_DECAY_OFF : 0)
+                | (limitMilliamps && tripMilliamps() > limitMilliamps ? BUILD_CURRENT : 0);
+        }
+
+    private:
+        unsigned int ctrl;
+        unsigned int torqueReg;
+        unsigned int off;
+        unsigned int blank;
+        unsigned int decay;
+        unsigned int drive;
+        unsigned int checks;          // field errors so far
+        unsigned int limitMilliamps;
+        unsigned int rsenseMilliohms;
+
+        constexpr drvBuild(unsigned int c, unsigned int t, unsigned int o, unsigned int b, unsigned int d,
+                           unsigned int r, unsigned int e, unsigned int ma, unsigned int mohm)
+            : ctrl(c), torqueReg(t), off(o), blank(b), decay(d), drive(r), checks(e),
+              limitMilliamps(ma), rsenseMilliohms(mohm) {}
+
+        // index of value among a..d, 4 if none
+        static constexpr unsigned int code(unsigned int value, unsigned int a, unsigned int b, unsigned int c, unsigned int d) {
+            return value == a ? 0 : value == b ? 1 : value == c ? 2 : value == d ? 3 : 4;
+        }
+
+        static constexpr unsigned int put(unsigned int reg, unsigned int mask, uint8_t shift, unsigned int value) {
+            return (reg & ~mask) | ((value << shift) & mask);
+        }
+
+        // sets a field, or records error if value does not fit its mask (code() gives 4, decMode 8)
+        constexpr drvBuild field(uint8_t address, unsigned int mask, uint8_t shift, unsigned int value, unsigned int error) const {
+            return ((value << shift) & ~mask) ? drvBuild(ctrl, torqueReg, off, blank, decay, drive, checks | error, limitMilliamps, rsenseMilliohms)
+                : drvBuild(address == 0 ? put(ctrl, mask, shift, value) : ctrl,
+                           address == 1 ? put(torqueReg, mask, shift, value) : torqueReg,
+                           address == 2 ? put(off, mask, shift, value) : off,
+                           address == 3 ? put(blank, mask, shift, value) : blank,
+                           address == 4 ? put(decay, mask, shift, value) : decay,
+                           address == 6 ? put(drive, mask, shift, value) : drive,
+                           checks, limitMilliamps, rsenseMilliohms);
+        }
+
+        constexpr unsigned int gain() const {
+            return 5U << ((ctrl >> 8) & 0x3);
+        }
+
+        constexpr unsigned int mode() const {
+            return (decay >> 8) & 0x7;
+        }
+};
+
+/*
+static_asserts config (a constexpr drvBuild) and defines name, its
+DRV_BUILD_FRAMES write frames in flash, for drv::loadTable()
+*/
+#define DRV_BUILD_TABLE(name, config) \
+    static_assert(!((config).errors() & BUILD_ISGAIN), "ISGAIN must be 5, 10, 20 or 40"); \
+    static_assert(!((config).errors() & BUILD_DTIME), "DTIME must be 410, 460, 670 or 880 ns"); \
+    static_assert(!((config).errors() & BUILD_TORQUE), "TORQUE must be 0-255"); \
+    static_assert(!((config).errors() & BUILD_TOFF), "TOFF must be 0-255"); \
+    static_assert(!((config).errors() & BUILD_TBLANK), "TBLANK must be 0-255"); \
+    static_assert(!((config).errors() & BUILD_TDECAY), "TDECAY must be 0-255"); \
+    static_assert(!((config).errors() & BUILD_DECMODE), "DECMODE must be slow 0, fast 2, mixed 3 or auto 5"); \
+    static_assert(!((config).errors() & BUILD_OCPTH), "OCPTH must be 250, 500, 750 or 1000 mV"); \
+    static_assert(!((config).errors() & BUILD_OCPDEG), "OCPDEG must be 1050, 2100, 4200 or 8400 ns"); \
+    static_assert(!((config).errors() & BUILD_TDRIVEN), "TDRIVEN must be 263, 525, 1050 or 2100 ns"); \
+    static_assert(!((config).errors() & BUILD_TDRIVEP), "TDRIVEP must be 263, 525, 1050 or 2100 ns"); \
+    static_assert(!((config).errors() & BUILD_IDRIVEN), "IDRIVEN must be 100, 200, 300 or 400 mA"); \
+    static_assert(!((config).errors() & BUILD_IDRIVEP), "IDRIVEP must be 50, 100, 150 or 200 mA"); \
+    static_assert(!((config).errors() & BUILD_BLANK_OFF), "TBLANK must be shorter than TOFF"); \
+    static_assert(!((config).errors() & BUILD_DECAY_OFF), "TDECAY must fit in TOFF in mixed / auto decay"); \
+    static_assert(!((config).errors() & BUILD_CURRENT), "TORQUE and ISGAIN trip above the current limit"); \
+    const uint16_t name[DRV_BUILD_FRAMES] PROGMEM = { \
+        (uint16_t)(config).frame(0), (uint16_t)(config).frame(1), (uint16_t)(config).frame(2), \
+        (uint16_t)(config).frame(3), (uint16_t)(config).frame(4), (uint16_t)(config).frame(5)}
@@ -0,0 +1,96 @@
+/*
+  drvConfig.cpp - persistent DRV8704 register image for fast warm boots
+
+  ** see drvConfig.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvConfig.h>
+
+#if DRV_HAS_EEPROM
+#include <EEPROM.h>
+#endif
+#if !defined(ARDUINO)
+#include <stdio.h>
+#endif
+
+uint16_t drvCrc16(const uint8_t* data, unsigned int length) {
+  uint16_t crc = 0xFFFF;
+  while (length--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void drvSealImage(drvConfigImage& image) {
+  image.magic = DRV_CONFIG_MAGIC;
+  image.version = DRV_CONFIG_VERSION;
+  image.count = DRV_CONFIG_REGS;
+  image.crc = drvCrc16((const uint8_t*)&image, sizeof(image) - sizeof(image.crc));
+}
+
+bool drvCheckImage(const drvConfigImage& image) {
+  return image.magic == DRV_CONFIG_MAGIC
+      && image.version == DRV_CONFIG_VERSION
+      && image.count == DRV_CONFIG_REGS
+      && image.crc == drvCrc16((const uint8_t*)&image, sizeof(image) - sizeof(image.crc));
+}
+
+#if DRV_HAS_EEPROM
+
+EepromConfigStore::EepromConfigStore(int address) {
+  base = address;
+}
+
+bool EepromConfigStore::load(uint8_t* data, unsigned int length) {
+  if (base + length > (unsigned int)EEPROM.length()) {
+    return false;
+  }
+  for (unsigned int i = 0; i < length; i++) {
+    data[i] = EEPROM.read(base + i);
+  }
+  return true;
+}
+
+bool EepromConfigStore::save(const uint8_t* data, unsigned int length) {
+  if (base + length > (unsigned int)EEPROM.length()) {
+    return false;
+  }
+  for (unsigned int i = 0; i < length; i++) {
+    EEPROM.update(base + i, data[i]);
+  }
+  return true;
+}
+
+#endif
+
+#if !defined(ARDUINO)
+
+FileConfigStore::FileConfigStore(const char* path) {
+  file = path;
+}
+
+bool FileConfigStore::load(uint8_t* data, unsigned int length) {
+  FILE* f = fopen(file, "rb");
+  if (!f) {
+    return false;
+  }
+  bool ok = fread(data, 1, length, f) == length;
+  fclose(f);
+  return ok;
+}
+
+bool FileConfigStore::save(const uint8_t* data, unsigned int length) {
+  FILE* f = fopen(file, "wb");
+  if (!f) {
+    return false;
+  }
+  bool ok = fwrite(data, 1, length, f) == length;
+  ok = (fclose(f) == 0) && ok;
+  return ok;
+}
+
+#endif
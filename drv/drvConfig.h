@@ -0,0 +1,107 @@
+/*
+  drvConfig.h - persistent DRV8704 register image for fast warm boots
+
+  drv::saveConfig() stores the configuration registers (CTRL..DRIVE) with a
+  version and CRC. drv::restoreConfig() checks the blob, reads the device
+  once and only writes the registers that differ, instead of replaying every
+  setter (three frames each) on every reset.
+
+  Usage:
+
+    EepromConfigStore store(0); // EEPROM address
+    drv motor(10);
+
+    void setup() {
+      if (motor.restoreConfig(store) < 0) {
+        motor.setTorque(128);  // first boot, or the image changed: configure
+        ...
+        motor.saveConfig(store);
+      }
+    }
+
+  On the host use FileConfigStore("drv.cfg") instead.
+
+*/
+#pragma once
+#include <Arduino.h>
+
+// bump when the image layout changes, old images are then ignored
+#define DRV_CONFIG_VERSION 1
+#define DRV_CONFIG_MAGIC 0xD874
+
+// CTRL, TORQUE, OFF, BLANK, DECAY, RESERVED, DRIVE
+#define DRV_CONFIG_REGS 7
+
+// boards whose core has EEPROM.h with update() and length(); SAMD, Due and
+// the others have no EEPROM library, give them a drvConfigStore of your own
+// (flash, FRAM, SD) or define DRV_HAS_EEPROM 1 for a core that has one
+#if !defined(DRV_HAS_EEPROM)
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR)
+#define DRV_HAS_EEPROM 1
+#else
+#define DRV_HAS_EEPROM 0
+#endif
+#endif
+
+struct drvConfigImage {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;
+    uint16_t regs[DRV_CONFIG_REGS];
+    uint16_t crc; // over everything above
+};
+
+/*
+CRC-16/CCITT (poly 0x1021, init 0xFFFF)
+*/
+uint16_t drvCrc16(const uint8_t* data, unsigned int length);
+
+/*
+fills in magic, version, count and crc for regs
+*/
+void drvSealImage(drvConfigImage& image);
+
+/*
+true if magic, version, count and crc all check out
+*/
+bool drvCheckImage(const drvConfigImage& image);
+
+/*
+somewhere to keep a drvConfigImage between boots
+*/
+class drvConfigStore {
+    public:
+        virtual bool load(uint8_t* data, unsigned int length) = 0;
+        virtual bool save(const uint8_t* data, unsigned int length) = 0;
+};
+
+#if DRV_HAS_EEPROM
+/*
+EEPROM starting at address, sizeof(drvConfigImage) bytes
+only changed bytes are written (EEPROM.update) to spare write cycles
+*/
+class EepromConfigStore : public drvConfigStore {
+    public:
+        EepromConfigStore(int address);
+        bool load(uint8_t* data, unsigned int length);
+        bool save(const uint8_t* data, unsigned int length);
+
+    private:
+        int base;
+};
+#endif
+
+#if !defined(ARDUINO)
+/*
+host build: a file holding the raw image
+*/
+class FileConfigStore : public drvConfigStore {
+    public:
+        FileConfigStore(const char* path);
+        bool load(uint8_t* data, unsigned int length);
+        bool save(const uint8_t* data, unsigned int length);
+
+    private:
+        const char* file;
+};
+#endif
@@ -0,0 +1,136 @@
+/*
+  drvCurrent.cpp - closed loop current regulation on ISENSE
+
+  ** see drvCurrent.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvCurrent.h>
+
+CurrentController::CurrentController(drv& device, drvAdc& isense, unsigned long periodMicros) {
+  dev = &device;
+  adc = &isense;
+  period = periodMicros;
+
+  kp = 64;
+  ki = 16;
+  lowSpeed = 100;
+  rippleHigh = 40;
+  rippleLow = 15;
+
+  target = 0;
+  measured = 0;
+  ripple = 0;
+  torque = dev->currentRegisterValues[dev->TORQUE] & 0x0FF;
+  decMode = (dev->currentRegisterValues[dev->DECAY] >> 8) & 0x7;
+  steps = 0;
+  frames = 0;
+
+  speed = 0;
+  integral = (int32_t)torque << 8;
+  windowSpread = 0;
+  windowSteps = 0;
+  next = micros();
+}
+
+void CurrentController::setTarget(uint16_t counts) {
+  if (target == 0 && counts != 0) {
+    // pick up from the TORQUE in use, no bump when the loop takes over
+    torque = dev->currentRegisterValues[dev->TORQUE] & 0x0FF;
+    integral = (int32_t)torque << 8;
+  }
+  target = counts;
+}
+
+void CurrentController::setSpeed(unsigned int stepsPerSecond) {
+  speed = stepsPerSecond;
+}
+
+bool CurrentController::poll() {
+  unsigned long now = micros();
+  if ((long)(now - next) < 0) {
+    return false;
+  }
+  next += period;
+  if ((long)(now - next) >= 0) {
+    next = now + period; // more than a period late, resync
+  }
+  step();
+  return true;
+}
+
+void CurrentController::step() {
+  uint32_t sum = 0;
+  uint16_t low = 0xFFFF;
+  uint16_t high = 0;
+  for (uint8_t i = 0; i < CURRENT_SAMPLES; i++) {
+    uint16_t s = adc->sample();
+    sum += s;
+    low = s < low ? s : low;
+    high = s > high ? s : high;
+  }
+  measured = sum / CURRENT_SAMPLES;
+  steps++;
+
+  // ripple: mean spread of the sample bursts over the window
+  windowSpread += high - low;
+  if (++windowSteps == CURRENT_RIPPLE_WINDOW) {
+    ripple = windowSpread / CURRENT_RIPPLE_WINDOW;
+    windowSpread = 0;
+    windowSteps = 0;
+    adaptDecay();
+  }
+
+  if (target == 0) {
+    return;
+  }
+
+  int32_t error = (int32_t)target - measured;
+
+  // integrator clamped to the TORQUE range, no windup while saturated
+  integral += (int32_t)ki * error;
+  if (integral < 0) {
+    integral = 0;
+  } else if (integral > (255L << 8)) {
+    integral = 255L << 8;
+  }
+
+  int32_t out = ((int32_t)kp * error + integral) >> 8;
+  if (out < 0) {
+    out = 0;
+  } else if (out > 255) {
+    out = 255;
+  }
+
+  torque = out;
+  if (dev->updateTorque(torque)) {
+    frames++;
+  }
+}
+
+void CurrentController::adaptDecay() {
+  uint8_t mode = decMode;
+
+  if (speed >= lowSpeed) {
+    mode = DECMODE_MIXED;
+  } else if (ripple > rippleHigh) {
+    if (mode == DECMODE_SLOW) {
+      mode = DECMODE_MIXED;
+    } else if (mode == DECMODE_MIXED) {
+      mode = DECMODE_AUTO;
+    }
+  } else if (ripple < rippleLow) {
+    if (mode == DECMODE_AUTO) {
+      mode = DECMODE_MIXED;
+    } else if (mode == DECMODE_MIXED) {
+      mode = DECMODE_SLOW;
+    }
+  }
+
+  if (mode != decMode) {
+    decMode = mode;
+    if (dev->updateDecMode(mode)) {
+      frames++;
+    }
+  }
+}
@@ -0,0 +1,104 @@
+/*
+  drvCurrent.h - closed loop current regulation on ISENSE
+
+  Samples ISENSE through a drvAdc, runs a fixed point PI loop at a fixed rate
+  and moves TORQUE through drv::updateTorque() (one frame, and only when the
+  value changes). Targets and readings are in ADC counts.
+
+  At low speed the chopper ripple decides DECMODE: too much ripple steps
+  slow -> mixed -> auto, little ripple steps back toward slow. Above
+  lowSpeed the loop holds mixed decay.
+
+  Usage:
+
+    AnalogPinAdc isense(A0);
+    CurrentController regulator(motor, isense, 1000); // 1 kHz
+    regulator.kp = 64; // Q8: 0.25 TORQUE per count of error
+    regulator.ki = 16;
+    regulator.setTarget(300);
+
+    void loop() {
+      regulator.setSpeed(stepsPerSecond);
+      regulator.poll();
+    }
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+#include <drvAdc.h>
+
+// DECMODE bit patterns
+#define DECMODE_SLOW 0
+#define DECMODE_FAST 2
+#define DECMODE_MIXED 3
+#define DECMODE_AUTO 5
+
+// ISENSE samples per loop step (min / max / mean are taken over them)
+#define CURRENT_SAMPLES 4
+
+// loop steps per ripple decision
+#define CURRENT_RIPPLE_WINDOW 32
+
+class CurrentController {
+    public:
+
+        CurrentController(drv& device, drvAdc& isense, unsigned long periodMicros);
+
+        /*
+        target current in ADC counts, 0 stops regulating (TORQUE is left alone)
+        */
+        void setTarget(uint16_t counts);
+
+        /*
+        speed hint in full steps per second, used for the decay choice
+        */
+        void setSpeed(unsigned int stepsPerSecond);
+
+        /*
+        call often from loop(), runs one step when a period has passed
+        returns true if a step ran
+        */
+        bool poll();
+
+        /*
+        one loop step, for timer driven use
+        */
+        void step();
+
+        // gains, Q8 fixed point (256 = 1 TORQUE LSB per count)
+        int16_t kp;
+        int16_t ki;
+
+        unsigned long period;
+
+        // below this speed DECMODE follows the ripple
+        unsigned int lowSpeed;
+
+        // ripple (max - min counts over a window) thresholds for the decay choice
+        uint16_t rippleHigh;
+        uint16_t rippleLow;
+
+        // last step
+        uint16_t target;
+        uint16_t measured;
+        uint16_t ripple;
+        uint8_t torque;
+        uint8_t decMode;
+
+        unsigned long steps;
+        unsigned long frames;   // SPI frames spent on TORQUE / DECMODE
+
+    private:
+
+        drv* dev;
+        drvAdc* adc;
+        unsigned long next;
+        unsigned int speed;
+
+        int32_t integral;       // Q8
+        uint16_t windowSpread;  // sum of burst max - min over the window
+        uint8_t windowSteps;
+
+        void adaptDecay();
+};
@@ -0,0 +1,109 @@
+/*
+  drvDc.cpp - brushed DC speed control on one DRV8704 bridge
+
+  ** see drvDc.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvDc.h>
+
+DcMotor::DcMotor(drv& device, drvPwm& output, uint8_t first, uint8_t second) {
+  dev = &device;
+  pwm = &output;
+  in1 = first;
+  in2 = second;
+  period = 1000;
+  slew = 16;
+  for (uint8_t i = 0; i < DC_CURVE; i++) {
+    curve[i] = (uint32_t)i * PWM_FULL / (DC_CURVE - 1);
+  }
+  frequency = 0;
+  minDuty = 0;
+  target = 0;
+  speed = 0;
+  duty = 0;
+  mode = DC_FAST;
+  next = micros();
+}
+
+unsigned long DcMotor::configure() {
+  // chopper cycle: off time plus blanking, the same timing ChopperTuner uses
+  unsigned long toff = ((unsigned long)dev->getTOff() + 1) * 525; // ns
+  unsigned long blank = 21UL * dev->getTBlank();
+  blank = blank < 1000 ? 1000 : blank;
+
+  unsigned long hz = 1000000000UL / (DC_CHOPS * (toff + blank));
+  hz = hz < DC_MIN_HZ ? DC_MIN_HZ : (hz > DC_MAX_HZ ? DC_MAX_HZ : hz);
+  frequency = pwm->setFrequency(hz);
+
+  // on time of at least two blanking times
+  unsigned long periodNs = 1000000000UL / frequency;
+  minDuty = (2 * blank * PWM_FULL + periodNs - 1) / periodNs;
+  if (minDuty > PWM_FULL) {
+    minDuty = PWM_FULL;
+  }
+
+  output();
+  return frequency;
+}
+
+void DcMotor::setMode(uint8_t value) {
+  mode = value == DC_SLOW ? DC_SLOW : DC_FAST;
+  output();
+}
+
+void DcMotor::setSpeed(int value) {
+  target = value > PWM_FULL ? PWM_FULL : (value < -PWM_FULL ? -PWM_FULL : value);
+}
+
+bool DcMotor::poll() {
+  unsigned long now = micros();
+  if ((long)(now - next) < 0) {
+    return false;
+  }
+  next += period;
+  if ((long)(now - next) >= 0) {
+    next = now + period;
+  }
+  update();
+  return true;
+}
+
+void DcMotor::update() {
+  if (speed < target) {
+    speed = (target - speed > slew) ? speed + slew : target;
+  } else if (speed > target) {
+    speed = (speed - target > slew) ? speed - slew : target;
+  }
+  output();
+}
+
+uint16_t DcMotor::lookup(uint16_t command) {
+  // PWM_FULL / 16 is 63.9, index by command * 16 / PWM_FULL and interpolate
+  uint32_t scaled = (uint32_t)command * (DC_CURVE - 1);
+  uint8_t i = scaled / PWM_FULL;
+  if (i >= DC_CURVE - 1) {
+    return curve[DC_CURVE - 1];
+  }
+  uint32_t part = scaled % PWM_FULL;
+  return curve[i] + ((int32_t)(curve[i + 1] - curve[i]) * (int32_t)part) / PWM_FULL;
+}
+
+void DcMotor::output() {
+  uint16_t magnitude = speed < 0 ? -speed : speed;
+  duty = magnitude ? lookup(magnitude) : 0;
+  if (duty > 0 && duty < minDuty) {
+    duty = minDuty;
+  }
+
+  // the driven pin carries the PWM, the other one holds the decay state
+  uint8_t driven = speed < 0 ? in2 : in1;
+  uint8_t other = speed < 0 ? in1 : in2;
+  if (mode == DC_FAST) {
+    pwm->write(other, 0);
+    pwm->write(driven, duty);         // off time: 0/0 coast
+  } else {
+    pwm->write(driven, PWM_FULL);
+    pwm->write(other, PWM_FULL - duty); // off time: 1/1 brake
+  }
+}
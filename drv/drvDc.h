@@ -0,0 +1,106 @@
+/*
+  drvDc.h - brushed DC speed control on one DRV8704 bridge
+
+  Owns the xIN1 / xIN2 PWM of a bridge (see drvPwm.h) and picks its frequency
+  from the chopper settings: the PWM period is DC_CHOPS chopper cycles
+  (TOFF off time + TBLANK blanking), so current regulation has several full
+  chopper cycles inside every on time instead of beating against them, and
+  the bridge does not switch faster than that needs. The shortest on time is
+  held at twice the blanking time, below that ISENSE would never be seen.
+
+  Drive modes (DRV8704 IN logic: 1/0 forward, 0/1 reverse, 0/0 coast,
+  1/1 brake):
+    DC_FAST - off time coasts (fast decay):  forward IN1 = PWM, IN2 = 0
+    DC_SLOW - off time brakes (slow decay):  forward IN1 = 1, IN2 = inverted PWM
+
+  Speed commands go through a lookup curve (17 points over 0..PWM_FULL, e.g.
+  to skip the deadband) and a slew limited ramp. poll() / update() only write
+  PWM compare values, there is no SPI traffic after configure().
+
+  Usage:
+
+    Timer1Pwm pwm;                      // pins 9, 10 to AIN1, AIN2
+    DcMotor axis(driver, pwm, 0, 1);
+    axis.configure();                   // reads TOFF / TBLANK once
+    axis.setMode(DC_SLOW);
+    axis.setSpeed(-600);                // -PWM_FULL..PWM_FULL
+
+    void loop() {
+      axis.poll();
+    }
+
+  Call configure() again after setTOff() / setTBlank().
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+#include <drvPwm.h>
+
+#define DC_FAST 0
+#define DC_SLOW 1
+
+// PWM period in chopper cycles
+#define DC_CHOPS 8
+
+// frequency range configure() stays in, Hz
+#define DC_MIN_HZ 1000
+#define DC_MAX_HZ 40000
+
+// lookup curve points (16 segments)
+#define DC_CURVE 17
+
+class DcMotor {
+    public:
+
+        DcMotor(drv& device, drvPwm& output, uint8_t in1, uint8_t in2);
+
+        /*
+        reads TOFF and TBLANK, sets the PWM frequency and the on time floor
+        returns the frequency the PWM runs at, Hz
+        */
+        unsigned long configure();
+
+        /*
+        DC_FAST or DC_SLOW
+        */
+        void setMode(uint8_t mode);
+
+        /*
+        target command -PWM_FULL..PWM_FULL, reached by the ramp
+        */
+        void setSpeed(int target);
+
+        /*
+        ramp step once per period, returns true if it ran
+        */
+        bool poll();
+
+        /*
+        one ramp step and PWM update
+        */
+        void update();
+
+        // settings
+        unsigned long period;       // us between ramp steps
+        uint16_t slew;              // command change per ramp step
+        uint16_t curve[DC_CURVE];   // command (in steps of PWM_FULL / 16) to duty, linear by default
+
+        // state
+        unsigned long frequency;    // Hz, from configure()
+        uint16_t minDuty;           // on time floor
+        int target;
+        int speed;                  // command now applied
+        uint16_t duty;              // duty now applied
+        uint8_t mode;
+
+    private:
+        drv* dev;
+        drvPwm* pwm;
+        uint8_t in1;
+        uint8_t in2;
+        unsigned long next;
+
+        uint16_t lookup(uint16_t command);
+        void output();
+};
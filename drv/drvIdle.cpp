@@ -0,0 +1,107 @@
+/*
+  drvIdle.cpp - idle hold current reduction with a single batch restore
+
+  ** see drvIdle.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvIdle.h>
+
+IdleManager::IdleManager(drv& device, unsigned long timeoutMillis) {
+  dev = &device;
+  timeout = timeoutMillis;
+  idleTorque = 0x40;
+  idleDecMode = IDLE_KEEP;
+  coilResistance = 4.0;
+  rsense = 0.05;
+  idle = false;
+  periods = 0;
+  idleMillis = 0;
+  savedJoules = 0;
+  last = millis();
+  since = 0;
+  savedWatts = 0;
+  frameCount = 0;
+}
+
+void IdleManager::begin() {
+  encode();
+  idle = false;
+  last = millis();
+}
+
+void IdleManager::encode() {
+  unsigned int torque = dev->currentRegisterValues[dev->TORQUE];
+  unsigned int decay = dev->currentRegisterValues[dev->DECAY];
+
+  runFrames[0] = (dev->TORQUE << 12) | torque;
+  idleFrames[0] = (dev->TORQUE << 12) | (torque & 0xF00) | idleTorque;
+  frameCount = 1;
+  if (idleDecMode != IDLE_KEEP) {
+    runFrames[1] = (dev->DECAY << 12) | decay;
+    idleFrames[1] = (dev->DECAY << 12) | (decay & ~0x700) | ((idleDecMode & 0x7) << 8);
+    frameCount = 2;
+  }
+
+  // ISGAIN 5 / 10 / 20 / 40 from CTRL bits 9-8
+  uint8_t gain = 5 << ((dev->currentRegisterValues[dev->CTRL] >> 8) & 0x3);
+  float ampsPerStep = 2.75 / 256 / (gain * rsense);
+  float run = (torque & 0x0FF) * ampsPerStep;
+  float held = idleTorque * ampsPerStep;
+  savedWatts = 2 * coilResistance * (run * run - held * held);
+  if (savedWatts < 0) {
+    savedWatts = 0;
+  }
+}
+
+bool IdleManager::activity() {
+  last = millis();
+  if (!idle) {
+    return false;
+  }
+  // a field written while idle (no longer at its idle value) is kept, the
+  // others go back to the run settings
+  unsigned int frames[2];
+  unsigned int torque = dev->currentRegisterValues[dev->TORQUE];
+  if ((torque & 0x0FF) == idleTorque) {
+    torque = (torque & ~0x0FF) | (runFrames[0] & 0x0FF);
+  }
+  frames[0] = (dev->TORQUE << 12) | torque;
+  if (frameCount == 2) {
+    unsigned int decay = dev->currentRegisterValues[dev->DECAY];
+    if (((decay >> 8) & 0x7) == (idleDecMode & 0x7)) {
+      decay = (decay & ~0x700) | (runFrames[1] & 0x700);
+    }
+    frames[1] = (dev->DECAY << 12) | decay;
+  }
+  dev->writeFrames(frames, frameCount);
+  idle = false;
+  account(last);
+  return true;
+}
+
+bool IdleManager::poll() {
+  if (idle || frameCount == 0) {
+    return false;
+  }
+  unsigned long now = millis();
+  if (now - last < timeout) {
+    return false;
+  }
+  encode(); // the run settings may have changed since the last restore
+  dev->writeFrames(idleFrames, frameCount);
+  idle = true;
+  since = now;
+  return true;
+}
+
+void IdleManager::account(unsigned long now) {
+  unsigned long spent = now - since;
+  float joules = savedWatts * spent / 1000;
+  periods++;
+  idleMillis += spent;
+  savedJoules += joules;
+#if DRV_STATS
+  dev->stats.recordIdle(spent, (unsigned long)(joules * 1000));
+#endif
+}
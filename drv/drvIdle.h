@@ -0,0 +1,104 @@
+/*
+  drvIdle.h - idle hold current reduction with a single batch restore
+
+  A parked motor does not need its running TORQUE to hold position, and
+  holding it there heats the part into the next move. IdleManager drops
+  TORQUE (and optionally DECMODE) once no motion command came for timeout
+  milliseconds, and puts the run settings back on the next one.
+
+  Going idle takes the run TORQUE / DECAY from the shadow as they are then
+  (so setters and updateTorque() in between are kept) and encodes the idle
+  and the restore frames, so activity() only sends ready made frames in one
+  batch: the TORQUE frame, followed by the DECAY frame when idleDecMode is
+  not IDLE_KEEP (two frames). Changes to idleTorque, idleDecMode and rsense
+  are picked up the same way; call begin() once to start the window.
+
+  TORQUE / DECMODE written while idle (setTorque(), updateTorque(),
+  updateDecMode(), ...) are kept by the restore: only a field still at its
+  idle value goes back to the run setting, the rest of both registers comes
+  from the shadow. Writing exactly the idle value while idle cannot be told
+  apart from no write and is restored.
+
+  Time spent idle and the energy saved are estimated from the trip currents
+  of both TORQUE values. The estimate assumes both coils carry their trip
+  current the whole time, which is true at full step positions; parked on
+  a single coil half step position only one coil does, and the real saving
+  is half of it:
+
+    Itrip = 2.75 V * TORQUE / 256 / (ISGAIN * rsense)
+    saved = 2 * coilResistance * (Irun^2 - Iidle^2) * t
+
+  and added to motor.stats (DRV_STATS builds, see drvStats.h) at the end of
+  every idle period, as well as kept in idleMillis / savedJoules here.
+
+  Usage:
+
+    IdleManager parking(motor, 500);   // idle after 0.5 s
+    parking.idleTorque = 0x30;
+    parking.idleDecMode = 0;           // slow decay
+    parking.begin();
+
+    void loop() {
+      if (moveRequested) {
+        parking.activity();            // before the first step
+        ...
+      }
+      parking.poll();
+    }
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+
+// idleDecMode: leave DECMODE alone
+#define IDLE_KEEP 0xFF
+
+class IdleManager {
+    public:
+
+        IdleManager(drv& device, unsigned long timeoutMillis);
+
+        /*
+        takes the run settings from the shadow, encodes the frames and
+        starts the window
+        */
+        void begin();
+
+        /*
+        a motion command: restores the run settings if idle, restarts the window
+        returns true if a restore was sent
+        */
+        bool activity();
+
+        /*
+        call often from loop(), goes idle once the window has passed
+        returns true if it went idle on this call
+        */
+        bool poll();
+
+        // settings
+        unsigned long timeout;   // ms without activity() before going idle
+        uint8_t idleTorque;
+        uint8_t idleDecMode;     // DECMODE bit pattern while idle, IDLE_KEEP
+        float coilResistance;    // ohm per coil
+        float rsense;            // ohm
+
+        // state
+        bool idle;
+        uint16_t periods;        // idle periods so far
+        unsigned long idleMillis; // finished idle periods, ms
+        float savedJoules;       // estimate over the finished idle periods
+
+    private:
+        drv* dev;
+        unsigned long last;      // millis() of the last activity
+        unsigned long since;     // millis() when idle began
+        float savedWatts;        // estimate while idle
+        unsigned int idleFrames[2];
+        unsigned int runFrames[2];
+        uint8_t frameCount;
+
+        void encode();
+        void account(unsigned long now);
+};
@@ -0,0 +1,305 @@
+/*
+  drvMotion.cpp - queued stepper moves with acceleration lookahead
+
+  ** see drvMotion.h for usage **
+
+*/
+#include <Arduino.h>
+#include <math.h>
+#include <drvMotion.h>
+
+// *** PHASE OUTPUT ***
+
+// coil polarity per half step position: +1 forward, -1 reverse, 0 off
+static const int8_t coilA[8] = {1, 0, -1, -1, -1, 0, 1, 1};
+static const int8_t coilB[8] = {1, 1, 1, 0, -1, -1, -1, 0};
+
+drvStepper::drvStepper(drv& device, uint8_t ain1, uint8_t ain2, uint8_t bin1, uint8_t bin2, bool half) {
+  dev = &device;
+  pins[0] = ain1;
+  pins[1] = ain2;
+  pins[2] = bin1;
+  pins[3] = bin2;
+  halfStep = half;
+  phase = 0;
+  bus = 0;
+#if !defined(ARDUINO)
+  onStep = 0;
+  stepContext = 0;
+#endif
+  torque = 0;
+  ticket = -1;
+  for (uint8_t i = 0; i < 8; i++) {
+    currents[i] = 0;
+  }
+}
+
+void drvStepper::begin() {
+  for (uint8_t i = 0; i < 4; i++) {
+    pinMode(pins[i], OUTPUT);
+  }
+  apply();
+}
+
+void drvStepper::step(int8_t dir) {
+  uint8_t stride = halfStep ? 1 : 2;
+  phase = (phase + (dir > 0 ? stride : 8 - stride)) & 0x7;
+  apply();
+#if !defined(ARDUINO)
+  if (onStep) {
+    onStep(stepContext, dir);
+  }
+#endif
+}
+
+void drvStepper::release() {
+  for (uint8_t i = 0; i < 4; i++) {
+    digitalWrite(pins[i], LOW);
+  }
+}
+
+void drvStepper::apply() {
+  digitalWrite(pins[0], coilA[phase] > 0 ? HIGH : LOW);
+  digitalWrite(pins[1], coilA[phase] < 0 ? HIGH : LOW);
+  digitalWrite(pins[2], coilB[phase] > 0 ? HIGH : LOW);
+  digitalWrite(pins[3], coilB[phase] < 0 ? HIGH : LOW);
+
+  uint8_t wanted = currents[phase];
+  if (bus == 0 || wanted == 0 || wanted == torque) {
+    return;
+  }
+  if (ticket >= 0) {
+    bus->poll(SEQ_CONTROL, ticket, 0); // release the previous slot
+  }
+  unsigned int value = (dev->currentRegisterValues[dev->TORQUE] & 0xF00) | wanted;
+  ticket = bus->submitWrite(dev, dev->TORQUE, value, SEQ_CONTROL);
+  if (ticket >= 0) {
+    torque = wanted;
+  }
+}
+
+// *** PLANNER ***
+
+MotionPlanner::MotionPlanner(drvStepper& output) {
+  out = &output;
+  head = 0;
+  count = 0;
+  planned = 0;
+  position = 0;
+  interval = 0;
+  running = false;
+  braking = false;
+  done = 0;
+  c = 0;
+  rest = 0;
+  n = 0;
+  fraction = 0;
+  due = 0;
+  waiting = false;
+}
+
+uint8_t MotionPlanner::pending() {
+  return count;
+}
+
+bool MotionPlanner::queue(long target, uint16_t rate, uint16_t accel) {
+  if (rate == 0 || rate > MOTION_MAX_RATE || accel == 0 || count >= MOTION_QUEUE) {
+    return false;
+  }
+  long delta = target - planned;
+  if (delta == 0) {
+    return true;
+  }
+
+  uint8_t total = count;
+  Move& m = moves[(head + total) % MOTION_QUEUE];
+  m.steps = delta > 0 ? delta : -delta;
+  m.dir = delta > 0 ? 1 : -1;
+  m.rate = rate;
+  m.accel = accel;
+  m.limit = 0; // from standstill
+  if (total > 0) {
+    Move& previous = moves[(head + total - 1) % MOTION_QUEUE];
+    if (previous.dir == m.dir) {
+      m.limit = previous.rate < rate ? previous.rate : rate;
+    }
+  }
+  m.entry = 0;
+  m.exit = 0;
+  profile(m);
+  planned = target;
+
+  noInterrupts();
+  count++;
+  interrupts();
+  replan();
+  return true;
+}
+
+// trapezoid (or triangle) from entry to exit within the move
+void MotionPlanner::profile(Move& m) {
+  float a2 = 2.0f * m.accel;
+  float entry2 = m.entry * m.entry;
+  float exit2 = m.exit * m.exit;
+  float peak2 = (float)m.rate * m.rate;
+  float up = (peak2 - entry2) / a2;
+  float down = (peak2 - exit2) / a2;
+  if (up + down > m.steps) {
+    up = (a2 * m.steps + exit2 - entry2) / (2.0f * a2);
+    if (up < 0) {
+      up = 0;
+    } else if (up > m.steps) {
+      up = m.steps;
+    }
+    peak2 = entry2 + a2 * up;
+    down = m.steps - up;
+  }
+  float peak = sqrtf(peak2);
+  if (peak < 1.0f) {
+    peak = 1.0f;
+  }
+
+  m.accelSteps = (uint32_t)up;
+  m.decelSteps = (uint32_t)ceilf(down);
+  m.cMin = (uint32_t)(256e6f / peak);
+  m.nEntry = (uint32_t)(entry2 / a2);
+  m.nPeak = (uint32_t)(peak2 / a2);
+  // first interval from standstill, 0.676 corrects the 1 / sqrt(n) ramp's start
+  m.cEntry = m.entry >= 1.0f ? (uint32_t)(256e6f / m.entry)
+                             : (uint32_t)(0.676f * sqrtf(2.0f / m.accel) * 256e6f);
+}
+
+void MotionPlanner::replan() {
+  Move plan[MOTION_QUEUE];
+  for (;;) {
+    uint8_t first = head;
+    uint8_t total = count;
+    bool active = running;
+    bool locked = braking;
+    if (total == 0) {
+      return;
+    }
+    for (uint8_t k = 0; k < total; k++) {
+      plan[k] = moves[(first + k) % MOTION_QUEUE];
+    }
+
+    // backward: every move must be able to brake to what follows
+    float next = 0;
+    for (int8_t k = total - 1; k >= 0; k--) {
+      Move& m = plan[k];
+      if (!(k == 0 && active && locked)) {
+        m.exit = next;
+      }
+      float reach = sqrtf(m.exit * m.exit + 2.0f * m.accel * m.steps);
+      if (!(k == 0 && active)) {
+        m.entry = reach < m.limit ? reach : m.limit;
+      }
+      next = m.entry;
+    }
+
+    // forward: and reach what it is asked to leave at
+    for (uint8_t k = 0; k < total; k++) {
+      Move& m = plan[k];
+      if (k > 0 && plan[k - 1].exit < m.entry) {
+        m.entry = plan[k - 1].exit;
+      }
+      float reach = sqrtf(m.entry * m.entry + 2.0f * m.accel * m.steps);
+      if (reach < m.exit) {
+        m.exit = reach;
+      }
+      profile(m);
+    }
+
+    noInterrupts();
+    if (head != first || running != active || braking != locked) {
+      interrupts();
+      continue; // the step ISR moved on meanwhile, plan again
+    }
+    for (uint8_t k = 0; k < total; k++) {
+      moves[(first + k) % MOTION_QUEUE] = plan[k];
+    }
+    interrupts();
+    return;
+  }
+}
+
+void MotionPlanner::start(Move& m) {
+  running = true;
+  braking = false;
+  done = 0;
+  rest = 0;
+  n = m.nEntry;
+  c = m.cEntry < m.cMin ? m.cMin : m.cEntry;
+}
+
+unsigned long MotionPlanner::step() {
+  if (!running) {
+    if (count == 0) {
+      interval = 0;
+      return 0;
+    }
+    start(moves[head]);
+  }
+
+  Move& m = moves[head];
+  out->step(m.dir);
+  position += m.dir;
+  done++;
+
+  uint32_t left = m.steps - done;
+  if (left == 0) {
+    running = false;
+    head = (head + 1) % MOTION_QUEUE;
+    count--;
+    if (count == 0) {
+      interval = 0;
+      return 0;
+    }
+    start(moves[head]);
+  } else if (braking || left <= m.decelSteps) {
+    if (!braking) {
+      braking = true;
+      if (n > m.nPeak) {
+        n = m.nPeak;
+      }
+    }
+    if (n > 1) {
+      c += (2 * c) / (4 * n - 1);
+      n--;
+    }
+  } else if (done < m.accelSteps) {
+    n++;
+    uint32_t num = 2 * c + rest;
+    c -= num / (4 * n + 1);
+    rest = num % (4 * n + 1);
+    if (c < m.cMin) {
+      c = m.cMin;
+    }
+  } else {
+    c = m.cMin;
+  }
+
+  // carry the Q8 fraction over, so whole us intervals keep the exact rate
+  uint32_t ticks = c + fraction;
+  fraction = ticks & 0xFF;
+  interval = ticks >> 8;
+  return interval;
+}
+
+bool MotionPlanner::poll() {
+  unsigned long now = micros();
+  if (waiting) {
+    if ((long)(now - due) < 0) {
+      return false;
+    }
+  } else if (count == 0) {
+    return false;
+  } else {
+    due = now;
+  }
+
+  unsigned long next = step();
+  waiting = next != 0;
+  due += next;
+  return true;
+}
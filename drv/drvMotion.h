@@ -0,0 +1,186 @@
+/*
+  drvMotion.h - queued stepper moves with acceleration lookahead
+
+  A stepper on the two DRV8704 bridges: drvStepper owns the AIN1/AIN2/BIN1/BIN2
+  pins and walks the full or half step phase table, MotionPlanner turns queued
+  moves into step intervals.
+
+  Moves are (target position, max rate, acceleration). Each queue() replans
+  the whole queue: the speed at a junction is the lower of the two rates when
+  the direction stays the same and 0 when it reverses, limited backwards by
+  what the following moves can still brake from and forwards by what the
+  previous ones can reach. The move being stepped keeps its entry speed and
+  can still get a higher exit speed until it starts braking.
+
+  Planning (loop context) uses float. Stepping is integer only: intervals are
+  Q8 microseconds, the accelerate / brake ramps use the recursive
+  c(n) = c(n-1) - 2 c(n-1) / (4n + 1) approximation of 1 / sqrt(n), one 32 bit
+  division per step. MOTION_MAX_RATE is the highest rate queue() accepts. On
+  the host a step costs 25 to 40 ns. On a 16 MHz AVR the division dominates
+  (~40 us a step), and keeping the timer ISR within a quarter of the step
+  period caps the rate at about 6000 steps/s, which is the AVR limit. Other
+  targets accept 20000; define MOTION_MAX_RATE before including this header
+  to change either.
+
+  The DRV8704 is only touched for the phase current table: if currents[] is
+  set, a TORQUE write is queued on a Sequencer (SEQ_CONTROL) whenever the
+  phase reaches a position with a different value, e.g. ~1.41x TORQUE on the
+  single coil positions of half stepping.
+
+  Usage (timer driven):
+
+    drvStepper coils(motor, 2, 3, 4, 5, true); // AIN1, AIN2, BIN1, BIN2, half step
+    MotionPlanner planner(coils);
+
+    ISR(TIMER1_COMPA_vect) {
+      OCR1A = planner.step() * 2;  // us to timer ticks; 0 while idle
+    }
+
+    planner.queue(4000, 3000, 8000); // to 4000 at up to 3000 steps/s, 8000 steps/s^2
+    planner.queue(0, 1500, 8000);
+
+  Or from loop() without a timer: planner.poll() steps when due.
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+#include <Sequencer.h>
+
+// queued moves, including the one being stepped
+#define MOTION_QUEUE 8
+
+// host builds: called after every step with its direction (see drvPlant::follow)
+#if !defined(ARDUINO)
+typedef void (*StepHook)(void* context, int8_t dir);
+#endif
+
+// steps/s, highest rate queue() accepts
+#ifndef MOTION_MAX_RATE
+#if defined(__AVR__)
+#define MOTION_MAX_RATE 6000
+#else
+#define MOTION_MAX_RATE 20000
+#endif
+#endif
+
+/*
+phase output on the IN pins: xIN1/xIN2 = 1/0 forward, 0/1 reverse, 0/0 coast
+*/
+class drvStepper {
+    public:
+
+        drvStepper(drv& device, uint8_t ain1, uint8_t ain2, uint8_t bin1, uint8_t bin2, bool halfStep);
+
+        /*
+        pins to outputs, coils energized at the present phase
+        */
+        void begin();
+
+        /*
+        one step forward (dir > 0) or back, ISR safe
+        */
+        void step(int8_t dir);
+
+        /*
+        both bridges coast
+        */
+        void release();
+
+        // half step position 0..7 (full stepping uses the even ones)
+        uint8_t phase;
+        bool halfStep;
+
+        // TORQUE per phase position, 0 leaves TORQUE alone (default)
+        uint8_t currents[8];
+        Sequencer* bus;
+
+#if !defined(ARDUINO)
+        // lets a host simulation follow the steps, not compiled for boards
+        StepHook onStep;
+        void* stepContext;
+#endif
+
+    private:
+        drv* dev;
+        uint8_t pins[4];
+        uint8_t torque;     // last TORQUE queued
+        int ticket;
+
+        void apply();
+};
+
+class MotionPlanner {
+    public:
+
+        MotionPlanner(drvStepper& output);
+
+        /*
+        adds a move to target (absolute steps) at up to rate steps/s,
+        accelerating and braking at accel steps/s^2
+        returns false if the queue is full or rate / accel is out of range
+        */
+        bool queue(long target, uint16_t rate, uint16_t accel);
+
+        /*
+        ISR: makes the step that is due and returns the us until the next one,
+        0 once the queue is empty (call again after queue())
+        */
+        unsigned long step();
+
+        /*
+        loop() alternative to a timer: steps when due by micros()
+        returns true if it stepped
+        */
+        bool poll();
+
+        /*
+        moves waiting or being stepped
+        */
+        uint8_t pending();
+
+        volatile long position;     // steps made so far
+        volatile unsigned long interval; // us to the next step, 0 when idle
+
+    private:
+
+        struct Move {
+            uint32_t steps;
+            int8_t dir;
+            uint16_t rate;
+            uint16_t accel;
+            float entry;            // planned speeds, steps/s
+            float exit;
+            float limit;            // highest junction speed into this move
+
+            // precomputed for step(), written with interrupts off
+            uint32_t accelSteps;
+            uint32_t decelSteps;
+            uint32_t cEntry;        // Q8 us
+            uint32_t cMin;
+            uint32_t nEntry;        // ramp index at entry speed
+            uint32_t nPeak;         // ramp index at the top speed
+        };
+
+        drvStepper* out;
+        Move moves[MOTION_QUEUE];
+        volatile uint8_t head;      // move being stepped
+        volatile uint8_t count;
+        long planned;               // target of the last queued move
+
+        // state of the move being stepped
+        volatile bool running;
+        volatile bool braking;
+        uint32_t done;
+        uint32_t c;                 // Q8 us
+        uint32_t rest;
+        uint32_t n;
+        uint8_t fraction;           // Q8 us not yet handed out
+
+        unsigned long due;
+        bool waiting;
+
+        void replan();
+        void profile(Move& m);
+        void start(Move& m);
+};
@@ -0,0 +1,188 @@
+/*
+  drvPlant.cpp - simulated motor winding behind a drvSim
+
+  ** see drvPlant.h for usage **
+
+*/
+#include <Arduino.h>
+#include <math.h>
+#include <limits.h>
+#include <drvPlant.h>
+
+drvPlant::drvPlant(drvSim& device) {
+  sim = &device;
+
+  resistance = 4.0;
+  inductance = 0.004;
+  supply = 12.0;
+  backEmf = 0.0;
+  rsense = 0.05;
+  vref = 5.0;
+  emfConstant = 0;
+  stopLow = LONG_MIN;
+  stopHigh = LONG_MAX;
+  ambient = 25.0;
+  rdsOn = 1.0;
+  thermalRes = 80.0;
+  thermalTau = 2.0;
+  otsTrip = 150.0;
+  otsRelease = 130.0;
+  ocpTrip = 8.0;
+  uvloTrip = 7.8;
+  resolution = 0.25;
+  adcMicros = 100.0;
+
+  current = 0;
+  driving = true;
+  elapsed = 0;
+  temperature = ambient;
+  overTemp = false;
+  otsTrips = 0;
+  shutdown = 0;
+  ocpTrips = 0;
+  uvloTrips = 0;
+  rotor = 0;
+  stalled = false;
+  lastStep = 0;
+  offLeft = 0;
+  fastLeft = 0;
+  blankLeft = 0;
+  clearStats();
+}
+
+void drvPlant::clearStats() {
+  peak = current;
+  minimum = current;
+  sum = 0;
+  squareSum = 0;
+  window = 0;
+  chops = 0;
+}
+
+static float isGain(unsigned int ctrl) {
+  static const float gains[] = {5, 10, 20, 40};
+  return gains[(ctrl >> 8) & 0x3];
+}
+
+float drvPlant::tripCurrent() {
+  return 2.75 * (sim->regs[0x1] & 0x0FF) / 256.0 / (isGain(sim->regs[0x0]) * rsense);
+}
+
+void drvPlant::advance(float us) {
+  const unsigned int* regs = sim->regs;
+  if (supply < uvloTrip) {
+    if (!(regs[0x7] & 0x020)) {
+      uvloTrips++;
+      sim->raiseFault(0x20);
+    }
+  } else {
+    sim->regs[0x7] &= ~0x020; // UVLO clears with the supply back
+  }
+  bool enabled = (regs[0x0] & 0x001) && !overTemp && !(regs[0x7] & 0x026);
+  float trip = tripCurrent();
+  float toff = ((regs[0x2] & 0x0FF) + 1) * 0.525;
+  float tblank = (regs[0x3] & 0x0FF) * 0.021;
+  tblank = tblank < 1.0 ? 1.0 : tblank; // never shorter than 1 us
+  float tdecay = (regs[0x4] & 0x0FF) * 0.525;
+  uint8_t mode = (regs[0x4] >> 8) & 0x7;
+
+  // exact RL step: i -> target + (i - target) * k, target = V / R
+  float k = exp(-resolution * 1e-6 * resistance / inductance);
+
+  float heat = 0; // I^2 * us over this call
+  for (float t = 0; t < us; t += resolution) {
+    float drive;
+
+    if (!enabled) {
+      drive = -supply - backEmf; // bridges off, current returns through the body diodes
+      driving = false;
+    } else if (driving) {
+      drive = supply - backEmf;
+      blankLeft -= resolution;
+      if (blankLeft <= 0 && current >= trip) {
+        // trip: start the off time
+        driving = false;
+        offLeft = toff;
+        if (mode == 2) {
+          fastLeft = toff;          // fast
+        } else if (mode == 3 || mode == 5) {
+          fastLeft = tdecay;        // mixed / auto: fast first, then slow
+        } else {
+          fastLeft = 0;             // slow
+        }
+        chops++;
+      }
+    }
+
+    if (enabled && !driving) {
+      drive = (fastLeft > 0) ? -supply - backEmf : -backEmf;
+      offLeft -= resolution;
+      fastLeft -= resolution;
+      if (offLeft <= 0) {
+        driving = true;
+        blankLeft = tblank;
+      }
+    }
+
+    float target = drive / resistance;
+    current = target + (current - target) * k;
+    if (current < 0) {
+      current = 0; // the bridge does not drive current backwards while decaying
+    }
+    if (enabled && current > ocpTrip) {
+      enabled = false; // latched until STATUS is cleared
+      ocpTrips++;
+      sim->raiseFault(0x02);
+    }
+
+    peak = current > peak ? current : peak;
+    minimum = current < minimum ? current : minimum;
+    sum += current * resolution;
+    squareSum += current * current * resolution;
+    heat += current * current * resolution;
+    window += resolution;
+  }
+  elapsed += us;
+  if (overTemp) {
+    shutdown += us;
+  }
+
+  // die temperature, first order towards ambient + P * Rth
+  float power = us > 0 ? heat / us * rdsOn : 0;
+  float settle = ambient + power * thermalRes;
+  float step = us * 1e-6 / thermalTau;
+  temperature += (settle - temperature) * (step > 1 ? 1 : step);
+
+  if (!overTemp && temperature >= otsTrip) {
+    overTemp = true;
+    otsTrips++;
+    sim->raiseFault(0x01);
+  } else if (overTemp && temperature <= otsRelease) {
+    overTemp = false;
+    sim->regs[0x7] &= ~0x001; // OTS clears itself once cool
+  }
+}
+
+uint16_t drvPlant::sample() {
+  advance(adcMicros);
+  float volts = current * rsense * isGain(sim->regs[0x0]);
+  float counts = volts / vref * 1023 + 0.5;
+  return counts > 1023 ? 1023 : (uint16_t)counts;
+}
+
+void drvPlant::step(int8_t dir) {
+  stalled = dir < 0 ? rotor <= stopLow : rotor >= stopHigh;
+  if (!stalled) {
+    rotor += dir;
+  }
+  if (emfConstant > 0) {
+    double interval = elapsed - lastStep;
+    float rate = (stalled || interval <= 0) ? 0 : 1e6 / interval;
+    backEmf = emfConstant * rate;
+  }
+  lastStep = elapsed;
+}
+
+void drvPlant::follow(void* plant, int8_t dir) {
+  ((drvPlant*)plant)->step(dir);
+}
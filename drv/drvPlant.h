@@ -0,0 +1,142 @@
+/*
+  drvPlant.h - simulated motor winding behind a drvSim
+
+  An RL winding with back EMF, chopped the way the DRV8704 does it using the
+  registers held by a drvSim: the bridge drives until the current reaches the
+  TORQUE / ISGAIN trip level, then decays for TOFF (slow, fast, or fast for
+  TDECAY then slow in mixed / auto mode). sample() reads it back as ISENSE
+  ADC counts, so the current loop, tuner and stall detector can be run on the
+  host against it.
+
+    Itrip = 2.75 V * TORQUE / 256 / (ISGAIN * Rsense)
+    counts = I * Rsense * ISGAIN / vref * 1023
+    tblank = max(1 us, TBLANK * 21 ns)    (the part's 1 us minimum blanking)
+    toff = (TOFF + 1) * 525 ns
+
+  ChopperTuner::valid() and drvBuild use the same blanking rule.
+
+  Rotor: step() moves it one step per commanded step unless that would take
+  it past stopLow or stopHigh, and with emfConstant set the back EMF follows
+  the step rate, so a stall (no motion, no back EMF) shows up in ISENSE the
+  way it does on a motor running below its trip current. To have a
+  drvStepper drive the rotor: coils.onStep = drvPlant::follow and
+  coils.stepContext = &plant.
+
+  A first order die temperature model heats with I^2 * rdsOn. Above otsTrip the
+  plant latches OTS in the drvSim STATUS and shuts the bridge down until it
+  has cooled to otsRelease, then clears OTS again (auto clear, like the part).
+
+  Current above ocpTrip latches AOCP and shuts the bridge down until the bit
+  is cleared in STATUS (clearFault(), as on the part). A supply below
+  uvloTrip latches UVLO and holds the bridge off; UVLO clears itself once the
+  supply is back above uvloTrip. Lower supply mid run to model a brown out.
+
+  Usage:
+
+    drvSim sim;
+    drvPlant motor(sim);
+    drv driver(0, sim);
+    CurrentController regulator(driver, motor, 1000);
+
+    for (...) {
+      motor.advance(10);      // 10 us of simulated time
+      regulator.step();
+    }
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drvSim.h>
+#include <drvAdc.h>
+
+class drvPlant : public drvAdc {
+    public:
+
+        drvPlant(drvSim& device);
+
+        // winding and supply
+        float resistance;   // ohm
+        float inductance;   // H
+        float supply;       // V
+        float backEmf;      // V, opposes the drive (raise it to model speed)
+        float rsense;       // ohm, sense resistor as fitted
+        float vref;         // V, ADC full scale
+
+        // mechanics
+        float emfConstant;  // V per step/s, 0 leaves backEmf as set (default)
+        long stopLow;       // the rotor cannot go below this (LONG_MIN: no stop)
+        long stopHigh;      // nor above this (LONG_MAX: no stop)
+
+        // thermal model
+        float ambient;      // C
+        float rdsOn;        // ohm, conduction loss seen by the die
+        float thermalRes;   // C/W, die to ambient
+        float thermalTau;   // s
+        float otsTrip;      // C, OTS sets and the bridge shuts down
+        float otsRelease;   // C, OTS clears again
+
+        // protection
+        float ocpTrip;      // A, AOCP latches and the bridge shuts down
+        float uvloTrip;     // V, UVLO while the supply is below this
+
+        // simulation step, us (chopper events are resolved to this)
+        float resolution;
+
+        // time each sample() takes (ADC conversion), us
+        float adcMicros;
+
+        /*
+        runs the winding for us microseconds of simulated time
+        */
+        void advance(float us);
+
+        /*
+        ISENSE in ADC counts, advances the plant by adcMicros first
+        */
+        uint16_t sample();
+
+        /*
+        one commanded step at the present simulated time
+        */
+        void step(int8_t dir);
+
+        /*
+        drvStepper::onStep hook, context is the drvPlant
+        */
+        static void follow(void* plant, int8_t dir);
+
+        // state
+        float current;      // A
+        bool driving;       // bridge on, false while decaying
+        double elapsed;     // us simulated so far
+        float temperature;  // C, die
+        bool overTemp;      // shut down by OTS
+        unsigned long otsTrips;
+        double shutdown;    // us spent shut down by OTS
+        unsigned long ocpTrips;
+        unsigned long uvloTrips;
+        long rotor;         // steps the rotor actually moved
+        bool stalled;       // last step was blocked by a stop
+
+        // statistics since clearStats()
+        float peak;
+        float minimum;
+        double sum;         // integral of current (A * us)
+        double squareSum;   // integral of current squared (A^2 * us)
+        double window;      // us covered by the sums
+        unsigned long chops;
+
+        void clearStats();
+
+        /*
+        current the chopper regulates to with the present registers, A
+        */
+        float tripCurrent();
+
+    private:
+        drvSim* sim;
+        float offLeft;      // us left in the off time
+        float fastLeft;     // us of fast decay left in the off time
+        float blankLeft;    // us of blanking left after turn on
+        double lastStep;    // elapsed at the previous step()
+};
@@ -0,0 +1,86 @@
+/*
+  drvProfiles.h - named register profiles with precomputed switch deltas
+
+  Each profile is a full CTRL..DRIVE image built at compile time. For every
+  pair of profiles the set of registers that differ is also worked out at
+  compile time, so drv::switchProfile() is one burst of at most that many
+  write frames, with no reads and no encoding.
+
+  Profiles (edit drvProfiles below to retune):
+    PROFILE_HOLD  - low TORQUE, slow decay
+    PROFILE_RUN   - full TORQUE, mixed decay
+    PROFILE_BRAKE - high TORQUE, slow decay, longer off time
+
+  The ENBL bit of CTRL is never changed by a profile switch.
+
+  Usage:
+
+    motor.switchProfile(PROFILE_RUN);
+    ... move ...
+    motor.switchProfile(PROFILE_HOLD);
+
+*/
+#pragma once
+#include <Arduino.h>
+
+#define PROFILE_HOLD 0
+#define PROFILE_RUN 1
+#define PROFILE_BRAKE 2
+#define PROFILE_COUNT 3
+
+// no profile known to be loaded, the next switch diffs against the shadow
+// (reading the registers the shadow cannot vouch for first)
+#define PROFILE_NONE 0xFF
+
+// CTRL, TORQUE, OFF, BLANK, DECAY, RESERVED, DRIVE
+#define PROFILE_REGS 7
+
+struct drvProfile {
+    unsigned int regs[PROFILE_REGS];
+};
+
+// register field encoders, usable in constant expressions
+constexpr unsigned int drvTorqueReg(unsigned int torque) {
+    return torque & 0x0FF;
+}
+
+constexpr unsigned int drvOffReg(unsigned int toff) {
+    return 0x100 | (toff & 0x0FF); // PWMMODE stays set
+}
+
+// decmode: 0 slow, 2 fast, 3 mixed, 5 auto (the DECMODE bit patterns)
+constexpr unsigned int drvDecayReg(unsigned int decmode, unsigned int tdecay) {
+    return ((decmode & 0x7) << 8) | (tdecay & 0x0FF);
+}
+
+constexpr drvProfile drvProfiles[PROFILE_COUNT] = {
+    // CTRL   TORQUE             OFF             BLANK  DECAY                RES    DRIVE
+    {{0x301, drvTorqueReg(0x40), drvOffReg(0x30), 0x080, drvDecayReg(0, 0x10), 0x000, 0xFA5}}, // HOLD
+    {{0x301, drvTorqueReg(0xFF), drvOffReg(0x30), 0x080, drvDecayReg(3, 0x10), 0x000, 0xFA5}}, // RUN
+    {{0x301, drvTorqueReg(0xC0), drvOffReg(0x60), 0x080, drvDecayReg(0, 0x10), 0x000, 0xFA5}}, // BRAKE
+};
+
+/*
+bit per register address that differs between profiles from and to
+(RESERVED never counts)
+*/
+constexpr uint8_t drvProfileDelta(uint8_t from, uint8_t to, uint8_t reg = 0) {
+    return reg >= PROFILE_REGS ? 0
+        : ((reg != 0x5 && drvProfiles[from].regs[reg] != drvProfiles[to].regs[reg]) ? (1 << reg) : 0)
+          | drvProfileDelta(from, to, reg + 1);
+}
+
+/*
+ready to send write frame for a profile register
+*/
+constexpr unsigned int drvProfileFrame(uint8_t profile, uint8_t reg) {
+    return ((unsigned int)reg << 12) | drvProfiles[profile].regs[reg];
+}
+
+constexpr uint8_t drvProfileDeltas[PROFILE_COUNT][PROFILE_COUNT] = {
+    {drvProfileDelta(0, 0), drvProfileDelta(0, 1), drvProfileDelta(0, 2)},
+    {drvProfileDelta(1, 0), drvProfileDelta(1, 1), drvProfileDelta(1, 2)},
+    {drvProfileDelta(2, 0), drvProfileDelta(2, 1), drvProfileDelta(2, 2)},
+};
+
+static_assert(PROFILE_COUNT == 3, "extend drvProfileDeltas when adding profiles");
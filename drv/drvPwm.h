@@ -0,0 +1,88 @@
+/*
+  drvPwm.h - where the xIN1 / xIN2 PWM comes from
+
+  DcMotor (drvDc.h) sets the PWM frequency from the chopper timing, which
+  analogWrite() cannot do, so it drives the IN pins through a drvPwm:
+
+    Timer1Pwm     - ATmega328P Timer1, phase correct with ICR1 as TOP:
+                    channel 0 is pin 9 (OC1A), channel 1 is pin 10 (OC1B)
+    AnalogPinPwm  - analogWrite() on any PWM pin, the channel is the pin;
+                    the frequency is whatever the board uses
+
+  Usage:
+
+    Timer1Pwm pwm;
+    DcMotor motor(driver, pwm, 0, 1);
+
+*/
+#pragma once
+#include <Arduino.h>
+
+// duty scale, 0 is always low and PWM_FULL always high
+#define PWM_FULL 1023
+
+class drvPwm {
+    public:
+        /*
+        asks for a frequency, returns the one the hardware actually runs at
+        */
+        virtual unsigned long setFrequency(unsigned long hz) = 0;
+
+        /*
+        duty 0..PWM_FULL on one channel
+        */
+        virtual void write(uint8_t channel, uint16_t duty) = 0;
+};
+
+class AnalogPinPwm : public drvPwm {
+    public:
+        AnalogPinPwm(unsigned long hz = 490) {
+            _HZ = hz;
+        }
+
+        /*
+        analogWrite() runs at a fixed frequency: the request is ignored and
+        the board frequency given to the constructor is returned
+        */
+        unsigned long setFrequency(unsigned long hz) {
+            (void)hz;
+            return _HZ;
+        }
+
+        void write(uint8_t channel, uint16_t duty) {
+            analogWrite(channel, duty >> 2);
+        }
+
+    private:
+        unsigned long _HZ;
+};
+
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+class Timer1Pwm : public drvPwm {
+    public:
+        unsigned long setFrequency(unsigned long hz) {
+            pinMode(9, OUTPUT);
+            pinMode(10, OUTPUT);
+            // no prescaler, phase correct: f = F_CPU / (2 * TOP)
+            unsigned long top = F_CPU / 2 / hz;
+            top = top > 0xFFFF ? 0xFFFF : (top < 0xFF ? 0xFF : top);
+            TCCR1A = _BV(COM1A1) | _BV(COM1B1) | _BV(WGM11);
+            TCCR1B = _BV(WGM13) | _BV(CS10);
+            ICR1 = top;
+            _TOP = top;
+            return F_CPU / 2 / top;
+        }
+
+        void write(uint8_t channel, uint16_t duty) {
+            uint16_t compare = (uint32_t)duty * _TOP / PWM_FULL;
+            if (channel == 0) {
+                OCR1A = compare;
+            } else {
+                OCR1B = compare;
+            }
+        }
+
+    private:
+        uint16_t _TOP;
+};
+#endif
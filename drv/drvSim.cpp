@@ -0,0 +1,74 @@
+/*
+  drvSim.cpp - simulated DRV8704 behind the drvTransport interface
+
+  ** see drvSim.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvSim.h>
+
+// power on values (the defaults documented in drv.h)
+static const unsigned int powerOnRegs[] = {0x301, 0x0FF, 0x130, 0x080, 0x010, 0x000, 0xFA5, 0x000};
+
+drvSim::drvSim() {
+  reset();
+}
+
+void drvSim::reset() {
+  for (uint8_t i = 0; i < 8; i++) {
+    regs[i] = powerOnRegs[i];
+  }
+  frames = 0;
+  reads = 0;
+  writes = 0;
+  selected = false;
+  unselectedFrames = 0;
+  stuckMiso = -1;
+}
+
+void drvSim::begin(int select) {
+}
+
+void drvSim::open(int select) {
+  selected = true;
+}
+
+void drvSim::close(int select) {
+  selected = false;
+}
+
+void drvSim::raiseFault(uint8_t bits) {
+  regs[0x7] |= bits & 0x03F;
+}
+
+unsigned int drvSim::transfer16(unsigned int frame) {
+  unsigned int response = answer(frame);
+  if (stuckMiso >= 0) {
+    return stuckMiso ? 0xFFFF : 0x0000;
+  }
+  return response;
+}
+
+unsigned int drvSim::answer(unsigned int frame) {
+  uint8_t address = (frame >> 12) & 0x7;
+  unsigned int data = frame & 0xFFF;
+
+  frames++;
+  if (!selected) {
+    unselectedFrames++;
+    return 0xFFFF; // nothing drives MISO
+  }
+
+  if (frame & 0x8000) {
+    reads++;
+    return regs[address];
+  }
+
+  writes++;
+  if (address == 0x7) {
+    regs[address] &= data | ~0x03F; // write 0 to clear a latched bit
+  } else {
+    regs[address] = data;
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+/*
+  drvSim.h - simulated DRV8704 behind the drvTransport interface
+
+  Holds the eight registers and answers frames the way the part does, so the
+  driver, traces and tasks can run without hardware (host builds, replays).
+
+    read frame  (bit 15 set)   -> response is the register in bits 11-0
+    write frame (bit 15 clear) -> register takes bits 11-0, STATUS bits written
+                                  0 are cleared (latched faults), 1 are ignored
+
+  Usage:
+
+    drvSim sim;
+    drv motor(0, sim);
+    sim.raiseFault(0x02);   // AOCP
+    motor.getFault();
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drvTransport.h>
+
+class drvSim : public drvTransport {
+    public:
+
+        drvSim();
+
+        void begin(int select);
+        void open(int select);
+        void close(int select);
+        unsigned int transfer16(unsigned int frame);
+
+        /*
+        back to the power on register values
+        */
+        void reset();
+
+        /*
+        latches fault bits in STATUS (bit 0 OTS ... bit 5 UVLO)
+        */
+        void raiseFault(uint8_t bits);
+
+        unsigned int regs[8];
+
+        // frames seen since reset()
+        unsigned long frames;
+        unsigned long reads;
+        unsigned long writes;
+
+        // true while SCS is asserted, a frame outside open()/close() is counted
+        bool selected;
+        unsigned long unselectedFrames;
+
+        // wiring faults: -1 answers normally (default), 0 / 1 holds MISO
+        // low / high (the frame still reaches the registers)
+        int stuckMiso;
+
+    private:
+        unsigned int answer(unsigned int frame);
+};
@@ -0,0 +1,149 @@
+/*
+  drvStall.cpp - sensorless stall detection and homing
+
+  ** see drvStall.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvStall.h>
+
+// *** DETECTOR ***
+
+StallDetector::StallDetector() {
+  shift = 2;
+  settleSteps = 16;
+  learnSteps = 32;
+  margin = 4;
+  confirm = 3;
+  reset();
+}
+
+void StallDetector::reset() {
+  mean = 0;
+  slope = 0;
+  baseline = 0;
+  noise = 0;
+  steps = 0;
+  over = 0;
+  stalled = false;
+  ocp = false;
+}
+
+bool StallDetector::update(uint16_t sample, unsigned int status) {
+  if (stalled) {
+    return true;
+  }
+  if (status & 0x006) {
+    ocp = true; // AOCP / BOCP
+    stalled = true;
+    return true;
+  }
+
+  int32_t value = (int32_t)sample << 8;
+  if (steps == 0) {
+    mean = value;
+  }
+  int32_t previous = mean;
+  mean += (value - mean) >> shift;
+  slope += ((mean - previous) - slope) >> shift;
+
+  if (steps < 0xFFFF) {
+    steps++;
+  }
+  if (steps <= settleSteps) {
+    return false;
+  }
+
+  int32_t deviation = value > mean ? value - mean : mean - value;
+  if (steps <= settleSteps + learnSteps) {
+    // running averages over the learning window
+    uint16_t k = steps - settleSteps;
+    baseline += (mean - baseline) / k;
+    noise += (deviation - noise) / k;
+    return false;
+  }
+
+  int32_t threshold = baseline + 4 * noise + ((int32_t)margin << 8);
+  if (mean > threshold && slope >= 0) {
+    if (++over >= confirm) {
+      stalled = true;
+    }
+  } else {
+    over = 0;
+  }
+  return stalled;
+}
+
+// *** HOMING ***
+
+HomingTask::HomingTask(drv& device, drvStepper& stepper, drvAdc& isense, int8_t dir) : drvTask(&device) {
+  coils = &stepper;
+  adcSource = &isense;
+  direction = dir < 0 ? -1 : 1;
+  maxSteps = 20000;
+  backoff = 32;
+  statusEvery = 8;
+  lag = 3;
+  position = 0;
+  home = 0;
+  stallSteps = 0;
+  backed = 0;
+}
+
+uint8_t HomingTask::poll() {
+  if (state != TASK_RUNNING) {
+    return state;
+  }
+
+  if (step == 0) {
+    detector.reset();
+    position = 0;
+    home = 0;
+    stallSteps = 0;
+    step = 1;
+  }
+
+  if (step == 1) {
+    // away from the stop while the detector learns, so a start on or near
+    // the stop does not teach it the stalled current
+    coils->step(-direction);
+    position -= direction;
+    detector.update(adcSource->sample(), 0);
+    if (detector.steps >= detector.settleSteps + detector.learnSteps) {
+      step = 2;
+    }
+    return TASK_RUNNING;
+  }
+
+  if (step == 2) {
+    // seeking the stop
+    coils->step(direction);
+    position += direction;
+    stallSteps++;
+
+    unsigned int status = 0;
+    if (statusEvery && stallSteps % statusEvery == 0) {
+      status = dev->read(dev->STATUS) & 0x03F;
+    }
+    if (detector.update(adcSource->sample(), status)) {
+      home = position - direction * lag;
+      if (detector.ocp) {
+        dev->write(dev->STATUS, 0x000); // clear the latched OCP, the bridge restarts
+      }
+      step = 3;
+      backed = 0;
+    } else if (stallSteps >= maxSteps) {
+      return finish(TASK_FAILED);
+    }
+    return TASK_RUNNING;
+  }
+
+  // backing off
+  if (backed >= backoff) {
+    return finish(TASK_DONE);
+  }
+  coils->step(-direction);
+  position -= direction;
+  backed++;
+  return backed >= backoff ? finish(TASK_DONE) : TASK_RUNNING;
+}
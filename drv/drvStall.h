@@ -0,0 +1,118 @@
+/*
+  drvStall.h - sensorless stall detection and homing
+
+  StallDetector takes one ISENSE sample per step. Below its trip current a
+  turning motor draws less than the chopper allows because the back EMF eats
+  into the supply; when the rotor stops the back EMF goes and the current
+  climbs. The detector keeps an EWMA of the current and of its change per
+  step, learns a baseline and its noise over the first steps of the move,
+  and flags a stall once the average has risen confirm steps in a row by more
+  than four times the noise (plus margin). AOCP / BOCP in STATUS flag a stall
+  at once (a DC motor against a stop, or a shorted coil).
+
+  Latency is bounded: about 2^shift steps for the EWMA to move plus confirm.
+
+  Home at a rate where the running current stays below the trip current. If
+  the chopper already regulates while turning, a stall changes nothing ISENSE
+  can see and only OCP (or maxSteps) ends the move; a baseline close to the
+  trip current in ADC counts means the rate is too low.
+
+  HomingTask steps at the rate its poll() is called (one step per poll, from
+  a timer or loop()). It first moves settleSteps + learnSteps (48) away from
+  the stop while the detector learns its baseline, so a move that starts on
+  the stop or close to it learns the free running current, not the stalled
+  one; leave that much travel behind the start. Then it steps towards the
+  stop, reads STATUS every statusEvery steps, and on a stall records home,
+  clears OCP if that was the trigger and backs off backoff steps. The stall
+  is flagged some steps after the rotor met the stop (the first blocked
+  step plus the detector latency), so home is the flagged position less lag
+  steps; the default 3 fits the default detector on drvPlant, re-measure it
+  for other shift / confirm settings.
+
+  Usage:
+
+    drvStepper coils(motor, 2, 3, 4, 5, true);
+    AnalogPinAdc isense(A0);
+    HomingTask homing(motor, coils, isense, -1);  // towards negative positions
+
+    while (homing.poll() == TASK_RUNNING) {
+      delayMicroseconds(1000);                    // 1000 steps/s
+    }
+    // homing.home: position of the stop, homing.position: after the back off
+
+  On the host: drvPlant with emfConstant set and stopLow / stopHigh, and the
+  stepper's onStep hook set to drvPlant::follow (see tests/test_stall.cpp).
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+#include <drvAdc.h>
+#include <drvTask.h>
+#include <drvMotion.h>
+
+class StallDetector {
+    public:
+
+        StallDetector();
+
+        /*
+        forget the baseline, call before each move
+        */
+        void reset();
+
+        /*
+        one step: ISENSE counts and the last STATUS (0 if not read this step)
+        returns true once a stall is seen (and keeps returning it until reset)
+        */
+        bool update(uint16_t sample, unsigned int status);
+
+        // settings
+        uint8_t shift;          // EWMA weight 1 / 2^shift per step
+        uint16_t settleSteps;   // ignored at the start of the move
+        uint16_t learnSteps;    // then averaged into the baseline
+        uint16_t margin;        // counts above baseline + 4 * noise
+        uint8_t confirm;        // steps in a row over the threshold
+
+        // state, Q8 counts
+        int32_t mean;
+        int32_t slope;          // change of mean per step
+        int32_t baseline;
+        int32_t noise;          // mean absolute deviation
+        uint16_t steps;
+        uint8_t over;
+        bool stalled;
+        bool ocp;               // the stall came from STATUS
+};
+
+class HomingTask : public drvTask {
+    public:
+
+        /*
+        dir: +1 or -1, the direction of the stop
+        */
+        HomingTask(drv& device, drvStepper& stepper, drvAdc& isense, int8_t dir);
+
+        /*
+        one step per call
+        */
+        uint8_t poll();
+
+        // settings
+        long maxSteps;          // fail if no stall within this, towards the stop
+        uint16_t backoff;       // steps back off the stop
+        uint8_t statusEvery;    // STATUS read every n steps, 0 never
+        uint8_t lag;            // steps past the stop when the stall is flagged
+        StallDetector detector;
+
+        // results, steps from where homing started
+        long position;
+        long home;              // the stop: where the stall was flagged, less lag
+        long stallSteps;        // steps towards the stop before the stall was flagged
+
+    private:
+        drvStepper* coils;
+        drvAdc* adcSource;
+        int8_t direction;
+        uint16_t backed;
+};
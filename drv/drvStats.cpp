@@ -0,0 +1,147 @@
+/*
+  drvStats.cpp - per operation counters and latency histograms for drv
+
+  ** see drvStats.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvStats.h>
+#include <Logger.h>
+
+static const char* const opNames[STAT_OPS] = {
+    "READ", "WRITE", "ENBL", "ISGAIN", "DTIME", "TORQUE", "TOFF", "TBLANK",
+    "TDECAY", "DECMOD", "OCPTH", "OCPDEG", "TDRIVEN", "TDRIVEP", "IDRIVEN", "IDRIVEP",
+};
+
+drvStats::drvStats() {
+  clear();
+}
+
+void drvStats::clear() {
+  memset(ops, 0, sizeof(ops));
+  memset(&idle, 0, sizeof(idle));
+}
+
+uint8_t drvStats::bucket(unsigned long micros) {
+  micros >>= STATS_SHIFT;
+  uint8_t b = 0;
+  while (micros && b < STATS_BUCKETS - 1) {
+    micros >>= 1;
+    b++;
+  }
+  return b;
+}
+
+const char* drvStats::name(uint8_t op) {
+  return op < STAT_OPS ? opNames[op] : "?";
+}
+
+bool drvStats::record(uint8_t op, unsigned long micros, bool ok) {
+  drvOpStats& s = ops[op];
+  if (s.calls < 0xFFFF) {
+    s.calls++;
+  }
+  if (!ok && s.errors < 0xFFFF) {
+    s.errors++;
+  }
+  uint16_t& b = s.buckets[bucket(micros)];
+  if (b < 0xFFFF) {
+    b++;
+  }
+  return ok;
+}
+
+void drvStats::recordIdle(unsigned long millis, unsigned long millijoules) {
+  if (idle.periods < 0xFFFF) {
+    idle.periods++;
+  }
+  idle.millis = (idle.millis > 0xFFFFFFFFUL - millis) ? 0xFFFFFFFFUL : idle.millis + millis;
+  idle.millijoules = (idle.millijoules > 0xFFFFFFFFUL - millijoules) ? 0xFFFFFFFFUL : idle.millijoules + millijoules;
+}
+
+void drvStats::dump(Logger& log) {
+  // two short lines per op, so even saturated counters fit in LOGGER_LINE
+  // behind the "DRV8704 - INFO: " prefix
+  LogLine legend;
+  legend.append("stats us buckets");
+  for (uint8_t b = 0; b < STATS_BUCKETS - 1; b++) {
+    legend.append(" <").append(1UL << (STATS_SHIFT + b));
+  }
+  legend.append(" more");
+  log.logi(legend.str());
+
+  for (uint8_t op = 0; op < STAT_OPS; op++) {
+    drvOpStats& s = ops[op];
+    if (s.calls == 0) {
+      continue;
+    }
+
+    LogLine counts;
+    counts.append(opNames[op]).append(" calls ").append(s.calls).append(" errors ").append(s.errors);
+    log.logi(counts.str());
+
+    LogLine buckets;
+    buckets.append(opNames[op]).append(" us");
+    for (uint8_t b = 0; b < STATS_BUCKETS; b++) {
+      buckets.append(" ").append(s.buckets[b]);
+    }
+    log.logi(buckets.str());
+  }
+
+  if (idle.periods) {
+    LogLine line;
+    line.append("IDLE periods ").append(idle.periods).append(" ms ").append(idle.millis).append(" mJ ").append(idle.millijoules);
+    log.logi(line.str());
+  }
+}
+
+static void putWord(Print& out, uint16_t value) {
+  out.write((uint8_t)(value & 0xFF));
+  out.write((uint8_t)(value >> 8));
+}
+
+static void putLong(Print& out, uint32_t value) {
+  putWord(out, value & 0xFFFF);
+  putWord(out, value >> 16);
+}
+
+static uint32_t getLong(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void drvStats::exportBinary(Print& out) {
+  const uint8_t header[] = {'D', 'S', STATS_VERSION, STAT_OPS, STATS_BUCKETS, STATS_SHIFT};
+  out.write(header, sizeof(header));
+  for (uint8_t op = 0; op < STAT_OPS; op++) {
+    putWord(out, ops[op].calls);
+    putWord(out, ops[op].errors);
+    for (uint8_t b = 0; b < STATS_BUCKETS; b++) {
+      putWord(out, ops[op].buckets[b]);
+    }
+  }
+  putWord(out, idle.periods);
+  putLong(out, idle.millis);
+  putLong(out, idle.millijoules);
+}
+
+bool drvStatsDecode(const uint8_t* data, unsigned int length, drvStats& stats) {
+  if (length < STATS_EXPORT_SIZE || data[0] != 'D' || data[1] != 'S' || data[2] != STATS_VERSION
+      || data[3] != STAT_OPS || data[4] != STATS_BUCKETS || data[5] != STATS_SHIFT) {
+    return false;
+  }
+
+  const uint8_t* p = data + 6;
+  for (uint8_t op = 0; op < STAT_OPS; op++) {
+    stats.ops[op].calls = p[0] | (p[1] << 8);
+    stats.ops[op].errors = p[2] | (p[3] << 8);
+    p += 4;
+    for (uint8_t b = 0; b < STATS_BUCKETS; b++) {
+      stats.ops[op].buckets[b] = p[0] | (p[1] << 8);
+      p += 2;
+    }
+  }
+  stats.idle.periods = p[0] | (p[1] << 8);
+  stats.idle.millis = getLong(p + 2);
+  stats.idle.millijoules = getLong(p + 6);
+  return true;
+}
@@ -0,0 +1,120 @@
+/*
+  drvStats.h - per operation counters and latency histograms for drv
+
+  Compiled in only when DRV_STATS is 1 (build flag -DDRV_STATS=1, or change the
+  default below). Every read, write and setter then records a call, whether it
+  failed (read of all ones / setter readback mismatch / setter given invalid
+  input) and how long it took in
+  micros(), into log2 buckets:
+
+    bucket 0: < 32 us, 1: < 64 us, 2: < 128 us ... 6: < 2048 us, 7: the rest
+
+  IdleManager (drvIdle.h) adds its idle periods, time and estimated energy
+  saved through recordIdle().
+
+  RAM: STAT_OPS * 20 + 10 bytes (330 bytes).
+
+  Usage:
+
+    motor.stats.dump(logger);       // two lines per used operation
+    motor.stats.exportBinary(Serial); // for drvStatsDecode() on the host
+
+  Binary export (little endian):
+    'D' 'S' version(1) ops buckets shift
+    then per op: calls(u16) errors(u16) buckets(u16 x buckets)
+    then idle: periods(u16) millis(u32) millijoules(u32)
+
+*/
+#pragma once
+#include <Arduino.h>
+
+#ifndef DRV_STATS
+#define DRV_STATS 0
+#endif
+
+#define STATS_VERSION 2
+#define STATS_BUCKETS 8
+#define STATS_SHIFT 5 // bucket 0 ends at 2^5 us
+
+// operations
+#define STAT_READ 0
+#define STAT_WRITE 1
+#define STAT_HBRIDGE 2
+#define STAT_ISGAIN 3
+#define STAT_DTIME 4
+#define STAT_TORQUE 5
+#define STAT_TOFF 6
+#define STAT_TBLANK 7
+#define STAT_TDECAY 8
+#define STAT_DECMODE 9
+#define STAT_OCPTH 10
+#define STAT_OCPDEG 11
+#define STAT_TDRIVEN 12
+#define STAT_TDRIVEP 13
+#define STAT_IDRIVEN 14
+#define STAT_IDRIVEP 15
+#define STAT_OPS 16
+
+#define STATS_EXPORT_SIZE (6 + STAT_OPS * (4 + 2 * STATS_BUCKETS) + 10)
+
+class Logger;
+
+struct drvOpStats {
+    uint16_t calls;
+    uint16_t errors;
+    uint16_t buckets[STATS_BUCKETS];
+};
+
+struct drvIdleStats {
+    uint16_t periods;
+    uint32_t millis;        // time spent at the idle settings
+    uint32_t millijoules;   // estimated coil energy saved
+};
+
+class drvStats {
+    public:
+
+        drvStats();
+
+        drvOpStats ops[STAT_OPS];
+        drvIdleStats idle;
+
+        /*
+        counts one call of op, returns ok so it can wrap a result
+        counters saturate at 65535
+        */
+        bool record(uint8_t op, unsigned long micros, bool ok);
+
+        /*
+        adds one finished idle period (see drvIdle.h), counters saturate
+        */
+        void recordIdle(unsigned long millis, unsigned long millijoules);
+
+        void clear();
+
+        /*
+        logs a legend line "stats us buckets <32 <64 ... more", then for every
+        op that was called "op calls N errors N" and "op us N N N N N N N N"
+        (one count per bucket), and "IDLE periods N ms N mJ N" once there
+        was an idle period. Every line fits LOGGER_LINE with saturated counters
+        */
+        void dump(Logger& log);
+
+        /*
+        writes the binary export described above
+        */
+        void exportBinary(Print& out);
+
+        /*
+        bucket index for a duration
+        */
+        static uint8_t bucket(unsigned long micros);
+
+        static const char* name(uint8_t op);
+};
+
+/*
+host side: parses an exportBinary() image into stats
+returns false if data is not a complete export of this version
+*/
+bool drvStatsDecode(const uint8_t* data, unsigned int length, drvStats& stats);
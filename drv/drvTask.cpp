@@ -0,0 +1,174 @@
+/*
+  drvTask.cpp - non blocking versions of the long DRV8704 operations
+
+  ** see drvTask.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvTask.h>
+
+// register addresses visited by the config tasks, in order
+static const uint8_t configRegs[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x6};
+static const uint8_t configRegCount = sizeof(configRegs);
+
+drvTask::drvTask(drv* device) {
+  dev = device;
+  restart();
+}
+
+uint8_t drvTask::run() {
+  while (poll() == TASK_RUNNING) {
+  }
+  return state;
+}
+
+void drvTask::restart() {
+  step = 0;
+  state = TASK_RUNNING;
+}
+
+uint8_t drvTask::finish(uint8_t result) {
+  state = result;
+  return state;
+}
+
+// *** PROBE ***
+
+ProbeTask::ProbeTask(drv* device) : drvTask(device) {
+}
+
+uint8_t ProbeTask::poll() {
+  if (state != TASK_RUNNING) {
+    return state;
+  }
+
+  if (step == 0x5) {
+    step++; // RESERVED register
+  }
+
+  unsigned int value = dev->read(step);
+  if (step == 0 && value == 0xFFFF) {
+    return finish(TASK_FAILED); // nothing is driving MISO
+  }
+  dev->currentRegisterValues[step] = value & ~0xF000;
+
+  step++;
+  if (step > dev->STATUS) {
+    return finish(TASK_DONE);
+  }
+  return TASK_RUNNING;
+}
+
+// *** DIAGNOSTIC ***
+
+DiagnosticTask::DiagnosticTask(drv* device, const unsigned int desiredRegs[]) : drvTask(device) {
+  desired = desiredRegs;
+  mismatches = 0;
+}
+
+uint8_t DiagnosticTask::poll() {
+  if (state != TASK_RUNNING) {
+    return state;
+  }
+  if (step == 0) {
+    mismatches = 0;
+  }
+
+  uint8_t address = configRegs[step];
+  unsigned int value = dev->read(address) & ~0xF000;
+  dev->currentRegisterValues[address] = value;
+  if (value != (desired[address] & ~0xF000)) {
+    mismatches |= 1 << address;
+  }
+
+  step++;
+  if (step < configRegCount) {
+    return TASK_RUNNING;
+  }
+  return finish(mismatches ? TASK_FAILED : TASK_DONE);
+}
+
+// *** APPLY CONFIG ***
+
+ApplyConfigTask::ApplyConfigTask(drv* device, const unsigned int regs[]) : drvTask(device) {
+  image = regs;
+  failed = 0;
+}
+
+uint8_t ApplyConfigTask::poll() {
+  if (state != TASK_RUNNING) {
+    return state;
+  }
+  if (step == 0) {
+    failed = 0;
+  }
+
+  // even steps write, odd steps read back
+  uint8_t address = configRegs[step >> 1];
+  unsigned int value = image[address] & ~0xF000;
+
+  if ((step & 1) == 0) {
+    dev->write(address, value);
+  } else {
+    unsigned int readback = dev->read(address) & ~0xF000;
+    dev->currentRegisterValues[address] = readback;
+    if (readback != value) {
+      failed |= 1 << address;
+    }
+  }
+
+  step++;
+  if (step < configRegCount * 2) {
+    return TASK_RUNNING;
+  }
+  return finish(failed ? TASK_FAILED : TASK_DONE);
+}
+
+// *** FAULT RECOVERY ***
+
+FaultRecoveryTask::FaultRecoveryTask(drv* device) : drvTask(device) {
+  status = 0;
+  ctrl = 0;
+}
+
+uint8_t FaultRecoveryTask::poll() {
+  if (state != TASK_RUNNING) {
+    return state;
+  }
+
+  switch (step) {
+    case 0: // what is latched
+      status = dev->read(dev->STATUS) & 0x03F;
+      for (uint8_t i = 0; i < 6; i++) {
+        dev->faults[i] = (status >> i) & 0x1;
+      }
+      if (status == 0) {
+        return finish(TASK_DONE);
+      }
+      break;
+    case 1: // remember ENBL
+      ctrl = dev->read(dev->CTRL) & ~0xF000;
+      break;
+    case 2: // bridges off while clearing
+      dev->write(dev->CTRL, ctrl & ~0x001);
+      break;
+    case 3:
+      dev->write(dev->STATUS, 0x000);
+      break;
+    case 4: // anything still latched stays disabled
+      status = dev->read(dev->STATUS) & 0x03F;
+      if (status != 0) {
+        return finish(TASK_FAILED);
+      }
+      if (!(ctrl & 0x001)) {
+        return finish(TASK_DONE);
+      }
+      break;
+    case 5:
+      dev->write(dev->CTRL, ctrl);
+      return finish(TASK_DONE);
+  }
+
+  step++;
+  return TASK_RUNNING;
+}
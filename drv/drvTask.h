@@ -0,0 +1,120 @@
+/*
+  drvTask.h - non blocking versions of the long DRV8704 operations
+
+  Probing, diagnostics, applying a configuration and fault recovery are all
+  chains of SPI frames. The tasks below run the same chains as explicit state
+  machines that clock at most one frame per poll(), so loop() keeps its cadence
+  while they run.
+
+  Usage:
+
+    drv motor(10);
+    ProbeTask probe(&motor);
+
+    void loop() {
+      if (probe.poll() == TASK_DONE) {
+        // motor.currentRegisterValues is filled
+      }
+      ... rest of loop ...
+    }
+
+  A finished task keeps returning its final state until restart().
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+
+// poll() results
+#define TASK_RUNNING 0
+#define TASK_DONE 1
+#define TASK_FAILED 2
+
+class drvTask {
+    public:
+
+        drvTask(drv* device);
+        virtual ~drvTask() {}
+
+        /*
+        advances the task by at most one bus transaction
+        returns TASK_RUNNING, TASK_DONE or TASK_FAILED
+        */
+        virtual uint8_t poll() = 0;
+
+        /*
+        runs the task to completion (blocking)
+        */
+        uint8_t run();
+
+        /*
+        rewinds the task so the next poll() starts over
+        */
+        void restart();
+
+        uint8_t state;
+
+    protected:
+
+        drv* dev;
+        uint8_t step;
+
+        uint8_t finish(uint8_t result);
+};
+
+/*
+reads every register into currentRegisterValues, one register per poll()
+fails if the bus reads back all ones (no device / MISO floating)
+*/
+class ProbeTask : public drvTask {
+    public:
+        ProbeTask(drv* device);
+        uint8_t poll();
+};
+
+/*
+compares registers against desired values (indexed by register address,
+RESERVED and STATUS are skipped), one register per poll()
+mismatches holds a bit per register address that did not match
+*/
+class DiagnosticTask : public drvTask {
+    public:
+        DiagnosticTask(drv* device, const unsigned int desiredRegs[]);
+        uint8_t poll();
+
+        uint8_t mismatches;
+
+    private:
+        const unsigned int* desired;
+};
+
+/*
+writes a full register image (indexed by address, RESERVED and STATUS are
+skipped) and reads each register back, alternating write / read per poll()
+failed holds a bit per register address whose readback did not match
+*/
+class ApplyConfigTask : public drvTask {
+    public:
+        ApplyConfigTask(drv* device, const unsigned int regs[]);
+        uint8_t poll();
+
+        uint8_t failed;
+
+    private:
+        const unsigned int* image;
+};
+
+/*
+reads STATUS, and if anything is latched: disables the bridges, clears
+STATUS, confirms it cleared and re-enables the bridges if they were on
+faults[] on the drv is updated from the first STATUS read
+*/
+class FaultRecoveryTask : public drvTask {
+    public:
+        FaultRecoveryTask(drv* device);
+        uint8_t poll();
+
+    private:
+        unsigned int status;
+        unsigned int ctrl;
+};
@@ -0,0 +1,188 @@
+/*
+  drvTelemetry.cpp - fixed rate binary STATUS / register telemetry
+
+  ** see drvTelemetry.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvTelemetry.h>
+
+uint8_t drvCobsEncode(const uint8_t* in, uint8_t len, uint8_t* out) {
+  uint8_t code = 1;
+  uint8_t codeAt = 0;
+  uint8_t w = 1;
+
+  for (uint8_t i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[codeAt] = code;
+      codeAt = w++;
+      code = 1;
+    } else {
+      out[w++] = in[i];
+      code++;
+    }
+  }
+  out[codeAt] = code;
+  return w;
+}
+
+uint8_t drvCobsDecode(const uint8_t* in, uint8_t len, uint8_t* out) {
+  uint8_t r = 0;
+  uint8_t w = 0;
+
+  while (r < len) {
+    uint8_t code = in[r++];
+    if (code == 0 || r + code - 1 > len) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; i++) {
+      out[w++] = in[r++];
+    }
+    if (code < 0xFF && r < len) {
+      out[w++] = 0;
+    }
+  }
+  return w;
+}
+
+static uint8_t* putWord(uint8_t* p, uint16_t value) {
+  *p++ = value & 0xFF;
+  *p++ = value >> 8;
+  return p;
+}
+
+static uint16_t getWord(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+// *** PRODUCER ***
+
+drvTelemetry::drvTelemetry(drv& device, Print& port, unsigned long periodMicros, bool withShadow) {
+  dev = &device;
+  out = &port;
+  period = periodMicros;
+  shadow = withShadow;
+  thermal = 0;
+  seq = 0;
+  sent = 0;
+  dropped = 0;
+  next = micros();
+}
+
+bool drvTelemetry::poll() {
+  unsigned long now = micros();
+  if ((long)(now - next) < 0) {
+    return false;
+  }
+  // fixed rate, a late poll does not shift the following samples
+  next += period;
+  if ((long)(now - next) >= 0) {
+    next = now + period; // fell more than a period behind, resync
+  }
+
+  uint8_t payload[TELEMETRY_PAYLOAD];
+  uint8_t* p = payload;
+  unsigned int* regs = dev->currentRegisterValues;
+
+  *p++ = TELEMETRY_TYPE;
+  p = putWord(p, seq);
+  p = putWord(p, now & 0xFFFF);
+  p = putWord(p, now >> 16);
+  p = putWord(p, dev->read(dev->STATUS) & 0x0FFF); // the one bus frame
+  *p++ = regs[dev->TORQUE] & 0xFF;
+  *p++ = ((regs[dev->CTRL] & 0x001) ? TELEMETRY_ENBL : 0) | (shadow ? TELEMETRY_SHADOW : 0)
+       | (thermal ? TELEMETRY_THERMAL : 0);
+  if (shadow) {
+    for (uint8_t i = 0; i < TELEMETRY_REGS; i++) {
+      p = putWord(p, regs[i] & 0x0FFF);
+    }
+  }
+  if (thermal) {
+    *p++ = thermal->ceiling;
+    *p++ = thermal->applied;
+    p = putWord(p, thermal->heat);
+    p = putWord(p, thermal->tripHeat);
+  }
+  p = putWord(p, drvCrc16(payload, p - payload));
+
+  uint8_t frame[TELEMETRY_FRAME];
+  uint8_t length = drvCobsEncode(payload, p - payload, frame);
+  frame[length++] = 0x00;
+
+  seq++;
+  if (out->availableForWrite() < length) {
+    dropped++;
+    return true;
+  }
+  out->write(frame, length);
+  sent++;
+  return true;
+}
+
+// *** DECODER ***
+
+drvTelemetryDecoder::drvTelemetryDecoder() {
+  length = 0;
+  overflow = false;
+  synced = false;
+  expected = 0;
+  packets = 0;
+  crcErrors = 0;
+  lost = 0;
+}
+
+bool drvTelemetryDecoder::feed(uint8_t byte, drvTelemetrySample& sample) {
+  if (byte != 0x00) {
+    if (length < sizeof(buffer)) {
+      buffer[length++] = byte;
+    } else {
+      overflow = true;
+    }
+    return false;
+  }
+
+  // end of packet
+  uint8_t payload[TELEMETRY_FRAME];
+  uint8_t size = overflow ? 0 : drvCobsDecode(buffer, length, payload);
+  bool empty = (length == 0);
+  length = 0;
+  overflow = false;
+  if (empty) {
+    return false; // back to back delimiters
+  }
+
+  uint8_t flags = size >= 11 ? payload[10] : 0;
+  bool withRegs = flags & TELEMETRY_SHADOW;
+  bool withThermal = flags & TELEMETRY_THERMAL;
+  uint8_t want = 13 + (withRegs ? 2 * TELEMETRY_REGS : 0) + (withThermal ? TELEMETRY_THERMAL_SIZE : 0);
+  if (size != want || payload[0] != TELEMETRY_TYPE
+      || getWord(payload + size - 2) != drvCrc16(payload, size - 2)) {
+    crcErrors++;
+    return false;
+  }
+
+  sample.seq = getWord(payload + 1);
+  sample.micros = getWord(payload + 3) | ((uint32_t)getWord(payload + 5) << 16);
+  sample.status = getWord(payload + 7);
+  sample.torque = payload[9];
+  sample.flags = payload[10];
+  const uint8_t* p = payload + 11;
+  for (uint8_t i = 0; i < TELEMETRY_REGS; i++) {
+    sample.regs[i] = withRegs ? getWord(p + 2 * i) : 0;
+  }
+  if (withRegs) {
+    p += 2 * TELEMETRY_REGS;
+  }
+  sample.ceiling = withThermal ? p[0] : 0;
+  sample.applied = withThermal ? p[1] : 0;
+  sample.heat = withThermal ? getWord(p + 2) : 0;
+  sample.tripHeat = withThermal ? getWord(p + 4) : 0;
+
+  if (synced && sample.seq != expected) {
+    lost += (uint16_t)(sample.seq - expected);
+  }
+  synced = true;
+  expected = sample.seq + 1;
+  packets++;
+  return true;
+}
@@ -0,0 +1,127 @@
+/*
+  drvTelemetry.h - fixed rate binary STATUS / register telemetry
+
+  Every period one STATUS read (the only SPI frame per sample) is packed with
+  TORQUE and ENBL, and optionally all of CTRL..DRIVE, from the drv shadow
+  registers. Packets carry a sequence number and CRC-16, are COBS framed
+  (0x00 ends a packet) and are only written when the port has room, so poll()
+  never blocks; samples that do not fit are counted in dropped.
+
+  Packet (before COBS, little endian):
+    type(1) seq(u16) micros(u32) status(u16) torque(u8) flags(u8)
+    [regs(u16 x 7) when flags & TELEMETRY_SHADOW]
+    [ceiling(u8) applied(u8) heat(u16) tripHeat(u16) when flags & TELEMETRY_THERMAL]
+    crc(u16)
+  flags: bit 0 ENBL, bit 1 regs included, bit 2 thermal derating state included
+
+  Wire size per sample: 15 bytes, 29 with the registers, 6 more with the
+  thermal state (21 / 35). At 1 kHz that is 15 to 35 kB/s, so use 250000 baud
+  up to 21 bytes and 500000 above. Bus load is one frame per sample.
+
+  Usage:
+
+    drvTelemetry telemetry(motor, Serial, 1000, false); // 1 kHz, STATUS only
+
+    void loop() {
+      telemetry.poll();
+    }
+
+  To include the derating state (drvThermal.h): telemetry.thermal = &derating.state;
+
+  On the host feed received bytes to a drvTelemetryDecoder.
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+#include <drvThermal.h>
+
+#define TELEMETRY_TYPE 1
+#define TELEMETRY_ENBL 0x01
+#define TELEMETRY_SHADOW 0x02
+#define TELEMETRY_THERMAL 0x04
+#define TELEMETRY_REGS 7
+#define TELEMETRY_THERMAL_SIZE 6
+
+// largest payload and its COBS encoding (+ overhead byte + delimiter)
+#define TELEMETRY_PAYLOAD (11 + 2 * TELEMETRY_REGS + TELEMETRY_THERMAL_SIZE + 2)
+#define TELEMETRY_FRAME (TELEMETRY_PAYLOAD + 2)
+
+struct drvTelemetrySample {
+    uint16_t seq;
+    uint32_t micros;
+    uint16_t status;
+    uint8_t torque;
+    uint8_t flags;
+    uint16_t regs[TELEMETRY_REGS]; // valid when flags & TELEMETRY_SHADOW
+    uint8_t ceiling;               // valid when flags & TELEMETRY_THERMAL
+    uint8_t applied;
+    uint16_t heat;
+    uint16_t tripHeat;
+};
+
+class drvTelemetry {
+    public:
+
+        /*
+        periodMicros: time between samples, withShadow: include CTRL..DRIVE
+        */
+        drvTelemetry(drv& device, Print& port, unsigned long periodMicros, bool withShadow);
+
+        /*
+        call often from loop(), samples and sends when a period has passed
+        returns true if a sample was taken
+        */
+        bool poll();
+
+        unsigned long period;
+        bool shadow;
+
+        // derating state to include, 0 for none
+        drvThermalState* thermal;
+
+        uint16_t seq;
+        unsigned long sent;
+        unsigned long dropped; // port had no room
+
+    private:
+        drv* dev;
+        Print* out;
+        unsigned long next;
+};
+
+/*
+host side: turns the byte stream back into samples
+*/
+class drvTelemetryDecoder {
+    public:
+
+        drvTelemetryDecoder();
+
+        /*
+        feed one received byte, returns true when sample holds a new sample
+        */
+        bool feed(uint8_t byte, drvTelemetrySample& sample);
+
+        unsigned long packets;
+        unsigned long crcErrors;  // bad CRC, bad COBS or wrong length
+        unsigned long lost;       // gaps in the sequence numbers
+
+    private:
+        uint8_t buffer[TELEMETRY_FRAME];
+        uint8_t length;
+        bool overflow;
+        bool synced;
+        uint16_t expected;
+};
+
+/*
+COBS encode len bytes (len < 254), returns bytes written to out (len + 1),
+no delimiter is added
+*/
+uint8_t drvCobsEncode(const uint8_t* in, uint8_t len, uint8_t* out);
+
+/*
+COBS decode, returns decoded length or 0 if the input is malformed
+*/
+uint8_t drvCobsDecode(const uint8_t* in, uint8_t len, uint8_t* out);
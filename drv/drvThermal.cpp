@@ -0,0 +1,114 @@
+/*
+  drvThermal.cpp - predictive thermal derating from STATUS and TORQUE history
+
+  ** see drvThermal.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvThermal.h>
+
+ThermalDerating::ThermalDerating(drv& device, unsigned long periodMicros) {
+  dev = &device;
+  period = periodMicros;
+  shift = 8;
+  margin = 230; // ~90 %
+  hysteresis = 2048; // ~3 % of full scale
+  minCeiling = 32;
+  relax = 1000;
+
+  requested = dev->currentRegisterValues[dev->TORQUE] & 0x0FF;
+  lastStatus = 0;
+  heat = 0;
+  quiet = 0;
+  derating = false;
+  next = micros();
+
+  state.ceiling = 255;
+  state.applied = requested;
+  state.heat = 0;
+  state.tripHeat = 0xFFFF;
+  state.otsEvents = 0;
+  state.ocpEvents = 0;
+  state.uvloEvents = 0;
+}
+
+void ThermalDerating::setTorque(uint8_t value) {
+  requested = value;
+}
+
+bool ThermalDerating::poll() {
+  unsigned long now = micros();
+  if ((long)(now - next) < 0) {
+    return false;
+  }
+  next += period;
+  if ((long)(now - next) >= 0) {
+    next = now + period;
+  }
+  update(dev->read(dev->STATUS));
+  return true;
+}
+
+// largest TORQUE whose steady state heat stays under the derating level
+uint8_t ThermalDerating::safeTorque() {
+  uint32_t limit = ((uint32_t)state.tripHeat * margin) >> 8;
+  // heat = torque^2 * 65535 / 255^2, solve for torque
+  uint32_t square = limit * 65025UL / 65535UL;
+  uint16_t root = 0;
+  for (uint16_t bit = 0x80; bit; bit >>= 1) {
+    if ((uint32_t)(root | bit) * (root | bit) <= square) {
+      root |= bit;
+    }
+  }
+  return root < minCeiling ? minCeiling : root;
+}
+
+void ThermalDerating::update(unsigned int status) {
+  // count rising edges of the fault bits
+  unsigned int rising = status & ~lastStatus;
+  lastStatus = status;
+  bool ots = rising & 0x001;
+  if (ots && state.otsEvents < 0xFF) {
+    state.otsEvents++;
+  }
+  if ((rising & 0x006) && state.ocpEvents < 0xFF) {
+    state.ocpEvents++;
+  }
+  if ((rising & 0x020) && state.uvloEvents < 0xFF) {
+    state.uvloEvents++;
+  }
+
+  // heat input: applied TORQUE squared, nothing while the bridge is off
+  bool driving = (dev->currentRegisterValues[dev->CTRL] & 0x001) && !(status & 0x001);
+  uint32_t input = driving ? (uint32_t)state.applied * state.applied * 65535UL / 65025UL : 0;
+  heat += ((int32_t)(input << 8) - (int32_t)heat) >> shift;
+  state.heat = heat >> 8;
+
+  // learn where the part trips, and slowly forget it again
+  if (ots) {
+    if (state.heat < state.tripHeat) {
+      state.tripHeat = state.heat;
+    }
+    quiet = 0;
+  } else if (++quiet >= relax) {
+    quiet = 0;
+    uint32_t raised = state.tripHeat + (state.tripHeat >> 8) + 1;
+    state.tripHeat = raised > 0xFFFF ? 0xFFFF : raised;
+  }
+
+  // derate before the estimate reaches the trip level, nothing to derate
+  // against before the first trip; safeTorque() holds the estimate just under
+  // start, so lift only once it has fallen well below
+  uint16_t start = ((uint32_t)state.tripHeat * margin) >> 8;
+  if (state.tripHeat == 0xFFFF) {
+    derating = false;
+  } else if (state.heat >= start) {
+    derating = true;
+  } else if (state.heat + hysteresis < start) {
+    derating = false;
+  }
+  state.ceiling = derating ? safeTorque() : 255;
+
+  state.applied = requested < state.ceiling ? requested : state.ceiling;
+  dev->updateTorque(state.applied);
+}
@@ -0,0 +1,83 @@
+/*
+  drvThermal.h - predictive thermal derating from STATUS and TORQUE history
+
+  Keeps a first order heat estimate driven by the square of the TORQUE
+  actually applied (power goes with current squared). Each OTS trip teaches it
+  the heat level the part trips at. Once the estimate gets within margin of
+  that level the TORQUE ceiling drops to what can be held indefinitely
+  without tripping, so the motor backs off a little instead of the bridge
+  shutting down. The ceiling lifts again only once the estimate has fallen
+  hysteresis below the derating level. Until the first OTS (or once the trip
+  level has been forgotten again) nothing is known to derate against and the
+  ceiling stays at 255. OCP and UVLO events are counted alongside.
+
+  Heat is a 0..65535 scale: 65535 is TORQUE 255 held forever. The time constant
+  is period * 2^shift, match it to the board (a few seconds for a bare part).
+
+  Usage:
+
+    ThermalDerating thermal(motor, 10000); // 100 Hz
+
+    void loop() {
+      thermal.setTorque(wanted);  // instead of motor.setTorque()
+      thermal.poll();             // one STATUS read per period
+    }
+
+  thermal.state is laid out for telemetry (see drvTelemetry).
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+
+struct drvThermalState {
+    uint8_t ceiling;     // TORQUE limit now in force
+    uint8_t applied;     // TORQUE last written
+    uint16_t heat;       // estimate, 0..65535
+    uint16_t tripHeat;   // learned trip level, 65535 until the first OTS
+    uint8_t otsEvents;
+    uint8_t ocpEvents;
+    uint8_t uvloEvents;
+};
+
+class ThermalDerating {
+    public:
+
+        ThermalDerating(drv& device, unsigned long periodMicros);
+
+        /*
+        the TORQUE the application wants, applied up to the ceiling
+        */
+        void setTorque(uint8_t value);
+
+        /*
+        call often from loop(), reads STATUS and updates once per period
+        returns true if it ran
+        */
+        bool poll();
+
+        /*
+        one update with a STATUS value read elsewhere (e.g. by drvTelemetry)
+        */
+        void update(unsigned int status);
+
+        drvThermalState state;
+
+        unsigned long period;
+        uint8_t shift;           // heat time constant is period << shift
+        uint8_t margin;          // start derating at tripHeat * margin / 256
+        uint16_t hysteresis;     // heat below that level before the ceiling lifts
+        uint8_t minCeiling;      // never derate below this
+        uint16_t relax;          // updates without OTS before tripHeat creeps up by 1/256
+
+    private:
+        drv* dev;
+        unsigned long next;
+        uint8_t requested;
+        unsigned int lastStatus;
+        uint32_t heat;           // Q8 of state.heat
+        uint16_t quiet;          // updates since the last OTS
+        bool derating;           // ceiling at safeTorque()
+
+        uint8_t safeTorque();
+};
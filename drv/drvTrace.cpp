@@ -0,0 +1,133 @@
+/*
+  drvTrace.cpp - SPI frame trace recorder and replayer
+
+  ** see drvTrace.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvTrace.h>
+
+TraceTransport::TraceTransport(drvTransport& inner, drvTraceEntry* ring, uint16_t capacity) {
+  bus = &inner;
+  entries = ring;
+  size = capacity;
+  recording = true;
+  clear();
+}
+
+void TraceTransport::clear() {
+  head = 0;
+  count = 0;
+  total = 0;
+}
+
+void TraceTransport::begin(int select) {
+  bus->begin(select);
+}
+
+void TraceTransport::open(int select) {
+  bus->open(select);
+}
+
+void TraceTransport::close(int select) {
+  bus->close(select);
+}
+
+unsigned int TraceTransport::transfer16(unsigned int frame) {
+  unsigned int response = bus->transfer16(frame);
+  if (!recording || size == 0) {
+    return response;
+  }
+
+  drvTraceEntry& e = entries[head];
+  e.frame = frame;
+  e.response = response;
+  e.micros = micros();
+
+  head = (head + 1 == size) ? 0 : head + 1;
+  if (count < size) {
+    count++;
+  }
+  total++;
+  return response;
+}
+
+const drvTraceEntry& TraceTransport::entry(uint16_t i) {
+  uint16_t oldest = (count < size) ? 0 : head;
+  uint16_t index = oldest + i;
+  if (index >= size) {
+    index -= size;
+  }
+  return entries[index];
+}
+
+static void putWord(Print& out, uint16_t value) {
+  out.write((uint8_t)(value & 0xFF));
+  out.write((uint8_t)(value >> 8));
+}
+
+void TraceTransport::dump(Print& out) {
+  const uint8_t header[] = {'D', 'T', TRACE_VERSION, 0};
+  out.write(header, sizeof(header));
+  putWord(out, count);
+
+  for (uint16_t i = 0; i < count; i++) {
+    const drvTraceEntry& e = entry(i);
+    putWord(out, e.frame);
+    putWord(out, e.response);
+    putWord(out, e.micros & 0xFFFF);
+    putWord(out, e.micros >> 16);
+  }
+}
+
+static uint16_t getWord(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+bool drvReplay(const uint8_t* data, unsigned int length, drvTransport& target, drvReplayResult& result, int select) {
+  if (length < TRACE_HEADER_SIZE || data[0] != 'D' || data[1] != 'T' || data[2] != TRACE_VERSION) {
+    return false;
+  }
+  uint16_t count = getWord(data + 4);
+  if (length < TRACE_HEADER_SIZE + (unsigned long)count * TRACE_ENTRY_SIZE) {
+    return false;
+  }
+
+  result.frames = 0;
+  result.mismatches = 0;
+  result.reads = 0;
+  result.writes = 0;
+  result.span = 0;
+  result.firstMismatch = -1;
+
+  target.begin(select);
+  const uint8_t* p = data + TRACE_HEADER_SIZE;
+  uint32_t first = 0;
+  for (uint16_t i = 0; i < count; i++, p += TRACE_ENTRY_SIZE) {
+    uint16_t frame = getWord(p);
+    uint16_t recorded = getWord(p + 2);
+    uint32_t at = getWord(p + 4) | ((uint32_t)getWord(p + 6) << 16);
+    if (i == 0) {
+      first = at;
+    }
+    result.span = at - first;
+
+    target.open(select);
+    uint16_t response = target.transfer16(frame);
+    target.close(select);
+
+    result.frames++;
+    if (frame & 0x8000) {
+      result.reads++;
+    } else {
+      result.writes++;
+    }
+    if (response != recorded) {
+      if (result.firstMismatch < 0) {
+        result.firstMismatch = i;
+      }
+      result.mismatches++;
+    }
+  }
+  return true;
+}
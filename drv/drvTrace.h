@@ -0,0 +1,101 @@
+/*
+  drvTrace.h - SPI frame trace recorder and replayer
+
+  TraceTransport sits between drv and the real transport and records every
+  frame: what went out, what came back and when (micros()). Recording is a
+  few stores per frame into a ring you provide; the oldest entries are
+  overwritten once it is full.
+
+  Usage (on the unit):
+
+    drvTraceEntry ring[128];
+    HardwareSpiTransport spi;
+    TraceTransport trace(spi, ring, 128);
+    drv motor(10, trace);
+    ...
+    trace.dump(Serial);
+
+  Usage (on the host, see drvSim.h):
+
+    drvSim sim;
+    drvReplayResult result;
+    drvReplay(data, length, sim, result);
+
+  or save the dump to a file and run tools/drvreplay on it (host build).
+
+  Dump format (little endian):
+    'D' 'T' version(1) reserved(0) count(u16)
+    then count entries, oldest first: frame(u16) response(u16) micros(u32)
+  bit 15 of frame is the direction (1 read, 0 write).
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drvTransport.h>
+
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 6
+#define TRACE_ENTRY_SIZE 8
+
+struct drvTraceEntry {
+    uint16_t frame;
+    uint16_t response;
+    uint32_t micros;
+};
+
+class TraceTransport : public drvTransport {
+    public:
+
+        TraceTransport(drvTransport& inner, drvTraceEntry* ring, uint16_t capacity);
+
+        void begin(int select);
+        void open(int select);
+        void close(int select);
+        unsigned int transfer16(unsigned int frame);
+
+        /*
+        recording can be paused, e.g. to freeze the ring right after a fault
+        */
+        bool recording;
+
+        /*
+        entries held (at most capacity) and frames seen in total
+        */
+        uint16_t count;
+        unsigned long total;
+
+        /*
+        i-th oldest entry held
+        */
+        const drvTraceEntry& entry(uint16_t i);
+
+        void clear();
+
+        /*
+        writes the dump format described above
+        */
+        void dump(Print& out);
+
+    private:
+        drvTransport* bus;
+        drvTraceEntry* entries;
+        uint16_t size;
+        uint16_t head;
+};
+
+struct drvReplayResult {
+    uint16_t frames;      // frames fed to the target
+    uint16_t mismatches;  // responses that differ from the recording
+    uint16_t reads;
+    uint16_t writes;
+    uint32_t span;        // micros between first and last frame of the recording
+    int32_t firstMismatch; // index of the first differing response, -1 if none
+};
+
+/*
+feeds a dump into target (typically a drvSim) frame by frame and compares
+the responses with the recorded ones, select is passed to the target's
+begin/open/close (only matters when replaying against hardware)
+returns false if data is not a valid dump
+*/
+bool drvReplay(const uint8_t* data, unsigned int length, drvTransport& target, drvReplayResult& result, int select = 0);
@@ -0,0 +1,120 @@
+/*
+  drvTransport.cpp - how drv frames get onto the wire
+
+  ** see drvTransport.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvTransport.h>
+
+void drvTransport::transferFrames(int select, const unsigned int* frames,
+                                  unsigned int* responses, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    open(select);
+    unsigned int response = transfer16(frames[i]);
+    close(select);
+    if (responses) {
+      responses[i] = response;
+    }
+  }
+}
+
+// *** HARDWARE SPI ***
+
+#if defined(ARDUINO)
+#include <SPI.h>
+
+
+void HardwareSpiTransport::begin(int select) {
+  pinMode(select, OUTPUT);
+  digitalWrite(select, LOW);
+  SPI.begin();
+}
+
+void HardwareSpiTransport::open(int select) {
+  digitalWrite(select, HIGH);
+  SPI.beginTransaction(SPISettings(140000, MSBFIRST, SPI_MODE0));
+}
+
+void HardwareSpiTransport::close(int select) {
+  SPI.endTransaction();
+  digitalWrite(select, LOW);
+}
+
+unsigned int HardwareSpiTransport::transfer16(unsigned int frame) {
+  return SPI.transfer16(frame);
+}
+#endif
+
+// *** SOFTWARE SPI ***
+
+SoftSpiTransport::SoftSpiTransport(int out, int in, int clk) {
+  _MOSI = out;
+  _MISO = in;
+  _SCLK = clk;
+}
+
+void SoftSpiTransport::begin(int select) {
+  pinMode(_MOSI, OUTPUT);
+  pinMode(_MISO, INPUT);
+  pinMode(_SCLK, OUTPUT);
+  pinMode(select, OUTPUT);
+  digitalWrite(_SCLK, LOW);
+  digitalWrite(select, LOW);
+
+#if defined(__AVR__)
+  // look the registers up once instead of on every digitalWrite
+  mosiPort = portOutputRegister(digitalPinToPort(_MOSI));
+  misoPort = portInputRegister(digitalPinToPort(_MISO));
+  sclkPort = portOutputRegister(digitalPinToPort(_SCLK));
+  mosiMask = digitalPinToBitMask(_MOSI);
+  misoMask = digitalPinToBitMask(_MISO);
+  sclkMask = digitalPinToBitMask(_SCLK);
+#endif
+}
+
+void SoftSpiTransport::open(int select) {
+  digitalWrite(select, HIGH);
+}
+
+void SoftSpiTransport::close(int select) {
+  digitalWrite(select, LOW);
+}
+
+unsigned int SoftSpiTransport::transfer16(unsigned int frame) {
+  unsigned int response = 0;
+
+#if defined(__AVR__)
+  // an ISR may touch other pins on these ports, keep the read-modify-writes atomic
+  uint8_t sreg = SREG;
+  noInterrupts();
+  for (uint8_t i = 0; i < 16; i++) {
+    if (frame & 0x8000) {
+      *mosiPort |= mosiMask;
+    } else {
+      *mosiPort &= ~mosiMask;
+    }
+    frame <<= 1;
+    *sclkPort |= sclkMask; // device samples on the rising edge
+    response <<= 1;
+    if (*misoPort & misoMask) {
+      response |= 1;
+    }
+    *sclkPort &= ~sclkMask;
+  }
+  SREG = sreg;
+#else
+  for (uint8_t i = 0; i < 16; i++) {
+    digitalWrite(_MOSI, (frame & 0x8000) ? HIGH : LOW);
+    frame <<= 1;
+    digitalWrite(_SCLK, HIGH);
+    response <<= 1;
+    if (digitalRead(_MISO)) {
+      response |= 1;
+    }
+    digitalWrite(_SCLK, LOW);
+  }
+#endif
+
+  return response;
+}
@@ -0,0 +1,165 @@
+/*
+  drvTransport.h - how drv frames get onto the wire
+
+  drv talks to the DRV8704 through a drvTransport. Three are provided:
+
+    HardwareSpiTransport - the SPI peripheral (default, drv(select)); on Linux
+                           the default is SpidevTransport (linux/drvSpidev.h)
+    SoftSpiTransport     - bit banged on any three pins chosen at runtime,
+                           port registers looked up once (drv(out, in, clk, select))
+    FastSoftSpi<...>     - bit banged on pins fixed at compile time, every pin
+                           access folds to a single sbi/cbi/sbic on ATmega328P
+
+  Usage (SPI peripheral taken by an SD card):
+
+    FastSoftSpi<7, 8, 9> bus;  // MOSI, MISO, SCLK
+    drv motor(10, bus);
+
+  All transports clock 16 bit frames MSB first in SPI mode 0 with SCS active high.
+
+*/
+#pragma once
+#include <Arduino.h>
+#if defined(ARDUINO)
+#include <SPI.h>
+#endif
+
+class drvTransport {
+    public:
+
+        virtual ~drvTransport() {}
+
+        /*
+        sets up pins / peripheral, called once before the first frame
+        */
+        virtual void begin(int select) = 0;
+
+        /*
+        asserts SCS and claims the bus
+        */
+        virtual void open(int select) = 0;
+
+        /*
+        releases the bus and SCS
+        */
+        virtual void close(int select) = 0;
+
+        /*
+        clocks one frame out, returns the word clocked in
+        */
+        virtual unsigned int transfer16(unsigned int frame) = 0;
+
+        /*
+        clocks count frames, each in its own SCS assertion, responses may be 0.
+        Goes frame by frame by default; transports that can queue frames in
+        one driver call (spidev) override it
+        */
+        virtual void transferFrames(int select, const unsigned int* frames,
+                                    unsigned int* responses, uint8_t count);
+};
+
+#if defined(ARDUINO)
+class HardwareSpiTransport : public drvTransport {
+    public:
+        void begin(int select);
+        void open(int select);
+        void close(int select);
+        unsigned int transfer16(unsigned int frame);
+};
+#endif
+
+class SoftSpiTransport : public drvTransport {
+    public:
+        SoftSpiTransport(int out, int in, int clk);
+
+        void begin(int select);
+        void open(int select);
+        void close(int select);
+        unsigned int transfer16(unsigned int frame);
+
+    private:
+        int _MOSI;
+        int _MISO;
+        int _SCLK;
+
+#if defined(__AVR__)
+        volatile uint8_t* mosiPort;
+        volatile uint8_t* misoPort;
+        volatile uint8_t* sclkPort;
+        uint8_t mosiMask;
+        uint8_t misoMask;
+        uint8_t sclkMask;
+#endif
+};
+
+/*
+pin access with the pin number as a template parameter, so the port and bit
+are constants and every call compiles to one instruction on ATmega328P boards
+(Uno, Nano, Pro Mini). Other boards fall back to digitalWrite/digitalRead.
+*/
+template <uint8_t pin>
+struct FastPin {
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__)
+    static_assert(pin < 20, "FastPin: ATmega328P digital pins are 0-19 (A0-A5 are 14-19)");
+
+    static inline void high() __attribute__((always_inline)) {
+        if (pin < 8) PORTD |= 1 << pin;
+        else if (pin < 14) PORTB |= 1 << (pin - 8);
+        else PORTC |= 1 << (pin - 14);
+    }
+    static inline void low() __attribute__((always_inline)) {
+        if (pin < 8) PORTD &= ~(1 << pin);
+        else if (pin < 14) PORTB &= ~(1 << (pin - 8));
+        else PORTC &= ~(1 << (pin - 14));
+    }
+    static inline bool read() __attribute__((always_inline)) {
+        if (pin < 8) return PIND & (1 << pin);
+        else if (pin < 14) return PINB & (1 << (pin - 8));
+        else return PINC & (1 << (pin - 14));
+    }
+#else
+    static inline void high() { digitalWrite(pin, HIGH); }
+    static inline void low() { digitalWrite(pin, LOW); }
+    static inline bool read() { return digitalRead(pin); }
+#endif
+};
+
+template <uint8_t out, uint8_t in, uint8_t clk>
+class FastSoftSpi : public drvTransport {
+    public:
+        void begin(int select) {
+            pinMode(out, OUTPUT);
+            pinMode(in, INPUT);
+            pinMode(clk, OUTPUT);
+            pinMode(select, OUTPUT);
+            FastPin<clk>::low();
+            digitalWrite(select, LOW);
+        }
+
+        void open(int select) {
+            digitalWrite(select, HIGH);
+        }
+
+        void close(int select) {
+            digitalWrite(select, LOW);
+        }
+
+        unsigned int transfer16(unsigned int frame) {
+            unsigned int response = 0;
+            for (uint8_t i = 0; i < 16; i++) {
+                if (frame & 0x8000) {
+                    FastPin<out>::high();
+                } else {
+                    FastPin<out>::low();
+                }
+                frame <<= 1;
+                FastPin<clk>::high(); // device samples on the rising edge
+                response <<= 1;
+                if (FastPin<in>::read()) {
+                    response |= 1;
+                }
+                FastPin<clk>::low();
+            }
+            return response;
+        }
+};
@@ -0,0 +1,161 @@
+/*
+  drvTuner.cpp - automatic TOFF / TBLANK / TDECAY / DECMODE tuning
+
+  ** see drvTuner.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvTuner.h>
+
+// DECMODE candidates, in the order tried
+static const uint8_t decModes[] = {0, 3, 5, 2}; // slow, mixed, auto, fast
+
+ChopperTuner::ChopperTuner(drv& device, drvAdc& isense, uint16_t counts) : drvTask(&device) {
+  adcSource = &isense;
+  target = counts;
+  maxWrites = 64;
+  samples = 32;
+  settleSamples = 4;
+  rippleWeight = 1;
+  trackWeight = 2;
+  initialStep = 32;
+  store = 0;
+
+  bestScore = 0xFFFFFFFF;
+  writes = 0;
+  evaluations = 0;
+}
+
+bool ChopperTuner::valid(const drvChopper& c) {
+  unsigned long blank = 21UL * c.tblank;
+  blank = blank < 1000 ? 1000 : blank;              // ns, never below 1 us
+  return blank < ((unsigned long)c.toff + 1) * 525; // ns
+}
+
+uint32_t ChopperTuner::measure() {
+  for (uint8_t i = 0; i < settleSamples; i++) {
+    adcSource->sample();
+  }
+
+  uint32_t sum = 0;
+  uint16_t low = 0xFFFF;
+  uint16_t high = 0;
+  for (uint8_t i = 0; i < samples; i++) {
+    uint16_t s = adcSource->sample();
+    sum += s;
+    low = s < low ? s : low;
+    high = s > high ? s : high;
+  }
+
+  uint16_t mean = sum / samples;
+  uint16_t error = mean > target ? mean - target : target - mean;
+  return (uint32_t)rippleWeight * (high - low) + (uint32_t)trackWeight * error;
+}
+
+void ChopperTuner::apply(const drvChopper& c) {
+  unsigned int* regs = dev->currentRegisterValues;
+  writes += dev->update(dev->OFF, (regs[dev->OFF] & 0xF00) | c.toff);
+  writes += dev->update(dev->BLANK, (regs[dev->BLANK] & 0xF00) | c.tblank);
+  writes += dev->update(dev->DECAY, (regs[dev->DECAY] & 0x800) | ((c.decMode & 0x7) << 8) | c.tdecay);
+}
+
+bool ChopperTuner::evaluate(const drvChopper& c) {
+  apply(c);
+  uint32_t score = measure();
+  evaluations++;
+  if (score < bestScore) {
+    best = c;
+    bestScore = score;
+    return true;
+  }
+  return false;
+}
+
+uint8_t ChopperTuner::finishTuning() {
+  apply(best);
+  if (store) {
+    dev->saveConfig(*store);
+  }
+  return finish(TASK_DONE);
+}
+
+uint8_t ChopperTuner::poll() {
+  if (state != TASK_RUNNING) {
+    return state;
+  }
+
+  if (step == 0) {
+    // baseline: whatever is loaded now
+    unsigned int* regs = dev->currentRegisterValues;
+    best.toff = regs[dev->OFF] & 0x0FF;
+    best.tblank = regs[dev->BLANK] & 0x0FF;
+    best.tdecay = regs[dev->DECAY] & 0x0FF;
+    best.decMode = (regs[dev->DECAY] >> 8) & 0x7;
+    bestScore = 0xFFFFFFFF;
+    writes = 0;
+    evaluations = 0;
+    evaluate(best);
+    mode = 0;
+    step = 1;
+    return TASK_RUNNING;
+  }
+
+  while (writes < maxWrites) {
+    if (step == 1) {
+      // decay modes first, they move the score the most
+      if (mode == sizeof(decModes)) {
+        field = 0;
+        direction = 1;
+        stepSize = initialStep;
+        improved = false;
+        step = 2;
+        continue;
+      }
+      drvChopper c = best;
+      c.decMode = decModes[mode++];
+      if (c.decMode == best.decMode) {
+        continue;
+      }
+      evaluate(c);
+      return TASK_RUNNING;
+    }
+
+    // pattern search over TOFF, TBLANK, TDECAY
+    drvChopper c = best;
+    uint8_t* value = field == 0 ? &c.toff : field == 1 ? &c.tblank : &c.tdecay;
+    int moved = *value + direction * stepSize;
+    bool tried = false;
+    bool better = false;
+    if (moved >= 0 && moved <= 255) {
+      *value = moved;
+      if (valid(c)) {
+        better = evaluate(c);
+        tried = true;
+      }
+    }
+
+    if (better) {
+      improved = true; // keep going the same way
+    } else if (direction > 0) {
+      direction = -1;
+    } else {
+      direction = 1;
+      if (++field == 3) {
+        field = 0;
+        if (!improved) {
+          stepSize >>= 1;
+          if (stepSize == 0) {
+            return finishTuning();
+          }
+        }
+        improved = false;
+      }
+    }
+
+    if (tried) {
+      return TASK_RUNNING;
+    }
+  }
+
+  return finishTuning(); // out of write budget
+}
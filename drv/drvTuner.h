@@ -0,0 +1,89 @@
+/*
+  drvTuner.h - automatic TOFF / TBLANK / TDECAY / DECMODE tuning
+
+  Scores chopper settings on ISENSE: ripple (max - min of a sample burst) and
+  tracking error (|mean - target|). DECMODE is tried first, then a pattern
+  search moves TOFF, TBLANK and TDECAY by a step that halves whenever a full
+  pass finds nothing better. Each candidate costs at most one or two register
+  writes (drv::update() skips unchanged registers). No new candidate starts
+  once maxWrites is reached, but the last one and applying the best settings
+  at the end (up to three writes) still count, so a run that ends on the
+  budget reports a few writes more than maxWrites. Candidates with the
+  blanking time not shorter than the off time are skipped.
+
+  It is a drvTask: each poll() evaluates one candidate, so it can run online
+  from loop() or to completion with run(). When done the best settings are
+  applied and, if a store was given, saved with drv::saveConfig().
+
+  Usage:
+
+    ChopperTuner tuner(motor, isense, 300); // hold the motor at 300 counts
+    tuner.store = &eeprom;
+    tuner.run();
+    // tuner.best holds the result, tuner.writes what it cost
+
+  Runs on the host against drvSim + drvPlant the same way.
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drv.h>
+#include <drvAdc.h>
+#include <drvTask.h>
+
+struct drvChopper {
+    uint8_t toff;
+    uint8_t tblank;
+    uint8_t tdecay;
+    uint8_t decMode;  // DECMODE bit pattern
+};
+
+class ChopperTuner : public drvTask {
+    public:
+
+        /*
+        target: the current (ADC counts) the present TORQUE should give
+        */
+        ChopperTuner(drv& device, drvAdc& isense, uint16_t target);
+
+        uint8_t poll();
+
+        // settings
+        uint16_t target;
+        uint16_t maxWrites;       // register write budget
+        uint8_t samples;          // ISENSE samples per score
+        uint8_t settleSamples;    // samples dropped after a change
+        uint8_t rippleWeight;
+        uint8_t trackWeight;
+        uint8_t initialStep;      // first pattern search step
+        drvConfigStore* store;    // saved to when done, 0 to skip
+
+        // results
+        drvChopper best;
+        uint32_t bestScore;
+        uint16_t writes;
+        uint16_t evaluations;
+
+        /*
+        score of the settings now in the device (lower is better)
+        */
+        uint32_t measure();
+
+        /*
+        true if the blanking time is shorter than the off time
+        */
+        static bool valid(const drvChopper& c);
+
+    private:
+
+        drvAdc* adcSource;
+        uint8_t mode;       // decmode candidate index
+        uint8_t field;      // 0 TOFF, 1 TBLANK, 2 TDECAY
+        int8_t direction;
+        uint8_t stepSize;
+        bool improved;      // anything better in this pass
+
+        void apply(const drvChopper& c);
+        bool evaluate(const drvChopper& c);
+        uint8_t finishTuning();
+};
@@ -0,0 +1,196 @@
+/*
+  Arduino.cpp - the part of the Arduino core the library uses, for Linux
+
+  ** see Arduino.h **
+
+*/
+#include <Arduino.h>
+#include <drvClock.h>
+#include <time.h>
+#include <errno.h>
+
+HardwareSerial Serial(stdout);
+
+// *** TIME ***
+
+static uint64_t monotonicMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+// counted from the first call, like from reset on the board (also safe
+// from other static constructors)
+static uint64_t sinceStart() {
+  static uint64_t start = monotonicMicros();
+  return monotonicMicros() - start;
+}
+
+unsigned long millis() {
+  if (VirtualClock::installed) {
+    return (unsigned long)(VirtualClock::installed->read() / 1000);
+  }
+  return (unsigned long)(sinceStart() / 1000);
+}
+
+unsigned long micros() {
+  if (VirtualClock::installed) {
+    return (unsigned long)VirtualClock::installed->read();
+  }
+  return (unsigned long)sinceStart();
+}
+
+static void sleepMicros(uint64_t us) {
+  struct timespec left;
+  left.tv_sec = us / 1000000;
+  left.tv_nsec = (us % 1000000) * 1000;
+  while (nanosleep(&left, &left) != 0 && errno == EINTR) {
+  }
+}
+
+void delay(unsigned long ms) {
+  if (VirtualClock::installed) {
+    VirtualClock::installed->advance((uint64_t)ms * 1000);
+    return;
+  }
+  sleepMicros((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (VirtualClock::installed) {
+    VirtualClock::installed->advance(us);
+    return;
+  }
+  sleepMicros(us);
+}
+
+// *** RANDOM ***
+
+// the installed VirtualClock's generator, or this one (seeded by randomSeed)
+static VirtualClock generator;
+
+long random(long max) {
+  if (max <= 0) {
+    return 0;
+  }
+  VirtualClock* source = VirtualClock::installed ? VirtualClock::installed : &generator;
+  return source->random((uint32_t)max);
+}
+
+long random(long min, long max) {
+  return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+  VirtualClock* source = VirtualClock::installed ? VirtualClock::installed : &generator;
+  source->seed(seed);
+}
+
+// *** NO GPIO / ADC ***
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t value) {}
+int digitalRead(uint8_t pin) { return 0; }
+int analogRead(uint8_t pin) { return 0; }
+void analogWrite(uint8_t pin, int value) {}
+
+void noInterrupts() {}
+void interrupts() {}
+
+// *** PRINT ***
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::print(const char* text) {
+  return write(text);
+}
+
+size_t Print::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t Print::print(int value) {
+  return print((long)value);
+}
+
+size_t Print::print(unsigned int value) {
+  return print((unsigned long)value);
+}
+
+size_t Print::print(long value) {
+  char text[24];
+  snprintf(text, sizeof(text), "%ld", value);
+  return write(text);
+}
+
+size_t Print::print(unsigned long value) {
+  char text[24];
+  snprintf(text, sizeof(text), "%lu", value);
+  return write(text);
+}
+
+size_t Print::print(double value, int digits) {
+  char text[48];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return write(text);
+}
+
+size_t Print::println() {
+  return write((const uint8_t*)"\r\n", 2);
+}
+
+size_t Print::println(const char* text) {
+  return print(text) + println();
+}
+
+size_t Print::println(char c) {
+  return print(c) + println();
+}
+
+size_t Print::println(int value) {
+  return print(value) + println();
+}
+
+size_t Print::println(unsigned int value) {
+  return print(value) + println();
+}
+
+size_t Print::println(long value) {
+  return print(value) + println();
+}
+
+size_t Print::println(unsigned long value) {
+  return print(value) + println();
+}
+
+size_t Print::println(double value, int digits) {
+  return print(value, digits) + println();
+}
+
+// *** SERIAL ***
+
+HardwareSerial::HardwareSerial(FILE* file) {
+  out = file;
+}
+
+void HardwareSerial::flush() {
+  fflush(out);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fputc(c, out) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  return fwrite(buffer, 1, size, out);
+}
+
+int HardwareSerial::availableForWrite() {
+  return BUFSIZ; // stdio buffers, a write never has to wait for the wire
+}
@@ -0,0 +1,107 @@
+/*
+  Arduino.h - the part of the Arduino core the library uses, for Linux
+
+  Lets drv/ and Logger/ build unchanged as a Linux userspace library (see
+  CMakeLists.txt). Time comes from CLOCK_MONOTONIC, or from a VirtualClock
+  once one is installed (drvClock.h), Serial writes to stdout.
+  There is no GPIO or ADC here: pinMode/digitalWrite are no-ops and
+  digitalRead/analogRead return 0, so talk to the part through a
+  SpidevTransport (drvSpidev.h) rather than the bit banged transports.
+
+*/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+void noInterrupts();
+void interrupts();
+
+class Print {
+    public:
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t* buffer, size_t size);
+        virtual int availableForWrite() { return 0; }
+
+        size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+        size_t print(const char* text);
+        size_t print(char c);
+        size_t print(int value);
+        size_t print(unsigned int value);
+        size_t print(long value);
+        size_t print(unsigned long value);
+        size_t print(double value, int digits = 2);
+
+        size_t println();
+        size_t println(const char* text);
+        size_t println(char c);
+        size_t println(int value);
+        size_t println(unsigned int value);
+        size_t println(long value);
+        size_t println(unsigned long value);
+        size_t println(double value, int digits = 2);
+};
+
+class Stream : public Print {
+    public:
+        virtual int available() { return 0; }
+        virtual int read() { return -1; }
+        virtual int peek() { return -1; }
+};
+
+/*
+a Stream writing to a stdio FILE*, nothing to read
+*/
+class HardwareSerial : public Stream {
+    public:
+        HardwareSerial(FILE* file);
+
+        void begin(unsigned long baud) {}
+        void end() {}
+        void flush();
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t* buffer, size_t size);
+        int availableForWrite();
+        using Print::write;
+
+        operator bool() { return true; }
+
+    private:
+        FILE* out;
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,169 @@
+/*
+  drvClock.cpp - virtual time for host runs of the driver
+
+  ** see drvClock.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvClock.h>
+
+VirtualClock* VirtualClock::installed = 0;
+
+VirtualClock::VirtualClock(uint32_t seed) {
+  readCost = 1;
+  eventsRun = 0;
+  reads = 0;
+  time = 0;
+  dispatching = false;
+  memset(events, 0, sizeof(events));
+  this->seed(seed);
+}
+
+VirtualClock::~VirtualClock() {
+  if (installed == this) {
+    uninstall();
+  }
+}
+
+void VirtualClock::install() {
+  installed = this;
+}
+
+void VirtualClock::uninstall() {
+  installed = 0;
+}
+
+uint64_t VirtualClock::read() {
+  reads++;
+  advance(readCost);
+  return time;
+}
+
+// *** EVENTS ***
+
+int VirtualClock::next(uint64_t until) {
+  // earliest due event, the lower slot first on a tie so runs repeat exactly
+  int found = -1;
+  for (int i = 0; i < CLOCK_EVENTS; i++) {
+    if (events[i].event && events[i].when <= until && (found < 0 || events[i].when < events[found].when)) {
+      found = i;
+    }
+  }
+  return found;
+}
+
+void VirtualClock::advance(uint64_t us) {
+  uint64_t until = time + us;
+  if (dispatching) {
+    // time an event spends, its own ISR is not interrupted
+    time = until;
+    return;
+  }
+
+  dispatching = true;
+  int i;
+  while ((i = next(until)) >= 0) {
+    Pending& pending = events[i];
+    uint64_t due = pending.when;
+    if (time < due) {
+      time = due;
+    }
+    ClockEvent event = pending.event;
+    unsigned long again = event(pending.context);
+    eventsRun++;
+    if (pending.event != event) {
+      continue; // cancelled while it ran
+    }
+    if (again) {
+      pending.when = due + again; // from the due time, periodic events do not drift
+    } else {
+      pending.event = 0;
+    }
+  }
+  if (time < until) {
+    time = until;
+  }
+  dispatching = false;
+}
+
+int VirtualClock::at(uint64_t when, ClockEvent event, void* context) {
+  for (int i = 0; i < CLOCK_EVENTS; i++) {
+    if (!events[i].event) {
+      events[i].when = when;
+      events[i].event = event;
+      events[i].context = context;
+      return i;
+    }
+  }
+  return -1;
+}
+
+int VirtualClock::after(uint64_t us, ClockEvent event, void* context) {
+  return at(time + us, event, context);
+}
+
+void VirtualClock::cancel(int id) {
+  if (id >= 0 && id < CLOCK_EVENTS) {
+    events[id].event = 0;
+  }
+}
+
+// *** RANDOM ***
+
+void VirtualClock::seed(uint32_t value) {
+  state = value ? value : 1; // xorshift never leaves 0
+}
+
+uint32_t VirtualClock::random() {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+uint32_t VirtualClock::random(uint32_t bound) {
+  return bound ? (uint32_t)(((uint64_t)random() * bound) >> 32) : 0;
+}
+
+unsigned long VirtualClock::exponential(unsigned long mean) {
+  // u in (0, 1], -ln(u) * mean
+  double u = ((random() >> 8) + 1) / 16777216.0;
+  double value = -log(u) * mean;
+  return value < 1 ? 1 : (unsigned long)value;
+}
+
+// *** TRANSPORT ***
+
+ClockedTransport::ClockedTransport(drvTransport& bus, VirtualClock& time, uint32_t hz) {
+  inner = &bus;
+  clock = &time;
+  speed = hz;
+  gap = 1;
+}
+
+uint64_t ClockedTransport::frameCost() {
+  return (16000000ULL + speed - 1) / speed + gap;
+}
+
+void ClockedTransport::begin(int select) {
+  inner->begin(select);
+}
+
+void ClockedTransport::open(int select) {
+  inner->open(select);
+}
+
+void ClockedTransport::close(int select) {
+  inner->close(select);
+}
+
+unsigned int ClockedTransport::transfer16(unsigned int frame) {
+  clock->advance(frameCost());
+  return inner->transfer16(frame);
+}
+
+void ClockedTransport::transferFrames(int select, const unsigned int* frames,
+                                      unsigned int* responses, uint8_t count) {
+  clock->advance(frameCost() * count);
+  inner->transferFrames(select, frames, responses, count);
+}
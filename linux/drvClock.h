@@ -0,0 +1,160 @@
+/*
+  drvClock.h - virtual time for host runs of the driver
+
+  Once a VirtualClock is installed, millis(), micros(), delay(),
+  delayMicroseconds() and random() in linux/Arduino.cpp read and move it
+  instead of CLOCK_MONOTONIC: nothing sleeps, a delay(60000) returns at once
+  with the clock a minute on, and a day of simulated operation runs as fast
+  as the code under test does. Two runs with the same seed and the same
+  program see the same times and the same random numbers.
+
+  Time moves only when the program asks for it:
+    delay(ms) / delayMicroseconds(us)  the clock moves by that much
+    millis() / micros()                every read costs readCost us (default
+                                       1), so busy waits on micros() end
+    ClockedTransport                   every frame costs its SPI clocking time
+    advance(us)                        from the scenario itself
+
+  Events stand in for timer interrupts and the outside world. An event is a
+  function called at its due time with its context; it returns the us until
+  it should run again, 0 to stop. Events run in time order whenever the
+  clock moves past them, with now() set to their due time, so main code sees
+  them the way it sees an ISR. Time an event spends (delay(), SPI) is added
+  to the clock but does not run other events until it returns.
+
+  Usage:
+
+    VirtualClock clock(42);               // seed
+    clock.install();
+
+    drvSim sim;
+    ClockedTransport bus(sim, clock);     // 140 kHz SPI timing
+    drv motor(0, bus);
+
+    unsigned long fault(void* context) {  // sporadic OCP, mean every 10 min
+      ((drvSim*)context)->raiseFault(0x02);
+      return VirtualClock::installed->exponential(600000000UL);
+    }
+    clock.after(clock.exponential(600000000UL), fault, &sim);
+
+    while (clock.now() < 86400000000ULL) { // a day
+      loop();
+      delay(10);
+    }
+
+  Give a long running loop a delay() per pass: spinning on millis() alone
+  moves the clock 1 us per read, and a day of that is 8.6e10 passes.
+  Serial still writes to stdout and takes no virtual time.
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drvTransport.h>
+
+// events pending at once
+#define CLOCK_EVENTS 32
+
+// us until the next run, 0 to stop
+typedef unsigned long (*ClockEvent)(void* context);
+
+class VirtualClock {
+    public:
+
+        VirtualClock(uint32_t seed = 1);
+        ~VirtualClock();
+
+        /*
+        makes this the time source of millis() / micros() / delay() / random()
+        */
+        void install();
+
+        /*
+        back to CLOCK_MONOTONIC
+        */
+        static void uninstall();
+
+        static VirtualClock* installed;
+
+        /*
+        us since the clock started
+        */
+        uint64_t now() { return time; }
+
+        /*
+        one millis() / micros() read: moves the clock by readCost, returns now()
+        */
+        uint64_t read();
+
+        /*
+        moves the clock on by us, running the events that come due on the way
+        */
+        void advance(uint64_t us);
+
+        /*
+        event at an absolute time / us from now
+        returns an id for cancel(), -1 if CLOCK_EVENTS are pending already
+        */
+        int at(uint64_t when, ClockEvent event, void* context);
+        int after(uint64_t us, ClockEvent event, void* context);
+
+        void cancel(int id);
+
+        /*
+        seeded generator (xorshift32): all bits / 0..bound-1 / exponentially
+        distributed intervals with the given mean, for sporadic events
+        */
+        uint32_t random();
+        uint32_t random(uint32_t bound);
+        unsigned long exponential(unsigned long mean);
+
+        /*
+        restarts the generator
+        */
+        void seed(uint32_t value);
+
+        // settings
+        unsigned long readCost;  // us each millis() / micros() read moves the clock
+
+        // statistics
+        unsigned long eventsRun;
+        unsigned long reads;     // millis() / micros() calls
+
+    private:
+        struct Pending {
+            uint64_t when;
+            ClockEvent event;
+            void* context;
+        };
+
+        uint64_t time;
+        uint32_t state;
+        bool dispatching;
+        Pending events[CLOCK_EVENTS];
+
+        int next(uint64_t until);
+};
+
+/*
+wraps a transport (a drvSim, a SimSpidev) and moves the clock by the time
+each frame takes on the wire: 16 bits at speed plus gap us with SCS released
+*/
+class ClockedTransport : public drvTransport {
+    public:
+
+        ClockedTransport(drvTransport& bus, VirtualClock& clock, uint32_t speed = 140000);
+
+        void begin(int select);
+        void open(int select);
+        void close(int select);
+        unsigned int transfer16(unsigned int frame);
+        void transferFrames(int select, const unsigned int* frames,
+                            unsigned int* responses, uint8_t count);
+
+        uint32_t speed;     // Hz
+        uint16_t gap;       // us between frames
+
+    private:
+        drvTransport* inner;
+        VirtualClock* clock;
+        uint64_t frameCost();
+};
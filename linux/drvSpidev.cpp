@@ -0,0 +1,165 @@
+/*
+  drvSpidev.cpp - DRV8704 on a Linux spidev device
+
+  ** see drvSpidev.h for usage **
+
+*/
+#include <Arduino.h>
+#include <drvSpidev.h>
+#include <Logger.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+extern Logger logger;
+
+SpidevTransport::SpidevTransport(uint8_t bus, uint32_t speed) {
+  this->bus = bus;
+  this->speed = speed;
+  gap = 1;
+  messages = 0;
+  framesSent = 0;
+  current = 0;
+  for (uint8_t i = 0; i < SPIDEV_SELECTS; i++) {
+    fds[i] = -1;
+  }
+}
+
+SpidevTransport::~SpidevTransport() {
+  for (uint8_t i = 0; i < SPIDEV_SELECTS; i++) {
+    if (fds[i] >= 0) {
+      ::close(fds[i]);
+    }
+  }
+}
+
+int SpidevTransport::openDevice(const char* path) {
+  int file = ::open(path, O_RDWR);
+  if (file < 0) {
+    return -1;
+  }
+  uint8_t mode = SPI_MODE_0 | SPI_CS_HIGH;
+  uint8_t bits = 8;
+  if (ioctl(file, SPI_IOC_WR_MODE, &mode) < 0
+      || ioctl(file, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0
+      || ioctl(file, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+    ::close(file);
+    return -1;
+  }
+  return file;
+}
+
+bool SpidevTransport::message(int file, struct spi_ioc_transfer* transfers, uint8_t count) {
+  return ioctl(file, SPI_IOC_MESSAGE(count), transfers) >= 0;
+}
+
+void SpidevTransport::begin(int select) {
+  if (select < 0 || select >= SPIDEV_SELECTS) {
+    logger.loge("spidev: select out of range");
+    return;
+  }
+  if (fds[select] >= 0) {
+    return; // another drv on this select opened it already
+  }
+  char path[32];
+  snprintf(path, sizeof(path), "/dev/spidev%u.%d", bus, select);
+  fds[select] = openDevice(path);
+  if (fds[select] < 0) {
+    logger.loge("spidev: cannot open device");
+  }
+}
+
+// the kernel asserts SCS around each transfer, open() only picks the device
+// transfer16() goes to
+void SpidevTransport::open(int select) {
+  current = select;
+}
+
+void SpidevTransport::close(int select) {
+  (void)select;
+}
+
+unsigned int SpidevTransport::transfer16(unsigned int frame) {
+  unsigned int response = 0xFFFF;
+  transferFrames(current, &frame, &response, 1);
+  return response;
+}
+
+void SpidevTransport::transferFrames(int select, const unsigned int* frames,
+                                     unsigned int* responses, uint8_t count) {
+  int fd = select >= 0 && select < SPIDEV_SELECTS ? fds[select] : -1;
+  struct spi_ioc_transfer transfers[SPIDEV_BATCH];
+  uint8_t tx[SPIDEV_BATCH][2];
+  uint8_t rx[SPIDEV_BATCH][2];
+
+  while (count > 0) {
+    uint8_t n = count < SPIDEV_BATCH ? count : SPIDEV_BATCH;
+    memset(transfers, 0, sizeof(transfers[0]) * n);
+    for (uint8_t i = 0; i < n; i++) {
+      tx[i][0] = frames[i] >> 8;
+      tx[i][1] = frames[i] & 0xFF;
+      rx[i][0] = 0xFF;
+      rx[i][1] = 0xFF;
+      transfers[i].tx_buf = (unsigned long)tx[i];
+      transfers[i].rx_buf = (unsigned long)rx[i];
+      transfers[i].len = 2;
+      transfers[i].speed_hz = speed;
+      transfers[i].bits_per_word = 8;
+      if (i + 1 < n) {
+        transfers[i].cs_change = 1; // release SCS before the next frame
+        transfers[i].delay_usecs = gap;
+      }
+    }
+
+    // all ones if the device is missing, as when nothing drives MISO
+    if (fd >= 0 && message(fd, transfers, n)) {
+      messages++;
+      framesSent += n;
+    }
+    if (responses) {
+      for (uint8_t i = 0; i < n; i++) {
+        responses[i] = (rx[i][0] << 8) | rx[i][1];
+      }
+      responses += n;
+    }
+    frames += n;
+    count -= n;
+  }
+}
+
+// *** SIMULATED DEVICE ***
+
+SimSpidev::SimSpidev(drvSim& device) : SpidevTransport(0) {
+  sim = &device;
+}
+
+int SimSpidev::openDevice(const char* path) {
+  (void)path;
+  sim->begin(0);
+  return 0;
+}
+
+bool SimSpidev::message(int file, struct spi_ioc_transfer* transfers, uint8_t count) {
+  (void)file;
+  bool selected = false;
+  for (uint8_t i = 0; i < count; i++) {
+    const uint8_t* tx = (const uint8_t*)(unsigned long)transfers[i].tx_buf;
+    uint8_t* rx = (uint8_t*)(unsigned long)transfers[i].rx_buf;
+    if (transfers[i].len != 2) {
+      return false;
+    }
+    if (!selected) {
+      sim->open(0);
+      selected = true;
+    }
+    unsigned int response = sim->transfer16((tx[0] << 8) | tx[1]);
+    rx[0] = response >> 8;
+    rx[1] = response & 0xFF;
+    // cs_change between transfers releases SCS, at the end it keeps it
+    if (transfers[i].cs_change ? i + 1 < count : i + 1 == count) {
+      sim->close(0);
+      selected = false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,96 @@
+/*
+  drvSpidev.h - DRV8704 on a Linux spidev device
+
+  The default transport of drv(select) on Linux: select is the chip select of
+  /dev/spidev<bus>.<select>. One transport serves every chip select of its
+  bus, keeping one open device per select (up to SPIDEV_SELECTS), so several
+  drv objects can share it and each frame goes to its own select.
+
+  Each frame is two bytes MSB first, SPI mode 0 with SPI_CS_HIGH (SCS is
+  active high). transferFrames() hands a whole batch of frames to the kernel
+  in one SPI_IOC_MESSAGE ioctl, with cs_change releasing SCS between them, so
+  drv::transfer(frames, ...) (restoreConfig, switchProfile) costs one syscall
+  instead of one per frame.
+
+  Usage:
+
+    drv motor(1);                 // /dev/spidev0.1
+    motor.getCurrentRegisters();
+
+    SpidevTransport bus(2, 500000); // /dev/spidev2.x at 500 kHz
+    drv other(0, bus);
+
+  SimSpidev is a SpidevTransport whose ioctl goes to a drvSim instead of the
+  kernel: the same transfer building and batching, no hardware needed.
+
+    drvSim sim;
+    SimSpidev bus(sim);
+    drv motor(0, bus);
+
+*/
+#pragma once
+#include <Arduino.h>
+#include <drvTransport.h>
+#include <drvSim.h>
+#include <linux/spi/spidev.h>
+
+// frames per SPI_IOC_MESSAGE, larger batches are split
+#define SPIDEV_BATCH 32
+
+// chip selects per bus, /dev/spidev<bus>.0 to .7
+#define SPIDEV_SELECTS 8
+
+class SpidevTransport : public drvTransport {
+    public:
+
+        SpidevTransport(uint8_t bus = 0, uint32_t speed = 140000);
+        virtual ~SpidevTransport();
+
+        void begin(int select);
+        void open(int select);
+        void close(int select);
+        unsigned int transfer16(unsigned int frame);
+        void transferFrames(int select, const unsigned int* frames,
+                            unsigned int* responses, uint8_t count);
+
+        uint8_t bus;
+        uint32_t speed;     // Hz
+        uint16_t gap;       // us SCS stays low between frames of a batch
+
+        // ioctls issued, frames clocked
+        unsigned long messages;
+        unsigned long framesSent;
+
+    protected:
+
+        /*
+        opens the device node and sets mode / word size / speed,
+        returns a file descriptor or -1
+        */
+        virtual int openDevice(const char* path);
+
+        /*
+        one SPI_IOC_MESSAGE of count transfers on file, returns false on error
+        */
+        virtual bool message(int file, struct spi_ioc_transfer* transfers, uint8_t count);
+
+        int fds[SPIDEV_SELECTS];  // per select, -1 until begin()
+
+    private:
+        int current;        // select of the last open(), for transfer16()
+};
+
+/*
+SpidevTransport with the ioctl answered by a drvSim (every select)
+*/
+class SimSpidev : public SpidevTransport {
+    public:
+        SimSpidev(drvSim& device);
+
+    protected:
+        int openDevice(const char* path);
+        bool message(int file, struct spi_ioc_transfer* transfers, uint8_t count);
+
+    private:
+        drvSim* sim;
+};
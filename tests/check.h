@@ -0,0 +1,48 @@
+/*
+  check.h - minimal assertions for the host tests
+
+  Each test is its own program (see CMakeLists.txt): CHECK() reports a
+  failed condition with its line and carries on, finish() returns the exit
+  code ctest reads.
+
+    int main() {
+      drvSim sim;
+      SimSpidev bus(sim);
+      drv motor(0, bus);
+      CHECK(motor.setTorque(100));
+      CHECK_EQ(sim.regs[1] & 0xFF, 100);
+      return finish();
+    }
+
+*/
+#pragma once
+#include <Arduino.h>
+
+static int checksFailed = 0;
+static int checksRun = 0;
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) checkEqual((long)(a), (long)(b), #a " == " #b, __FILE__, __LINE__)
+
+static inline bool check(bool ok, const char* text, const char* file, int line) {
+  checksRun++;
+  if (!ok) {
+    checksFailed++;
+    printf("%s:%d: CHECK failed: %s\n", file, line, text);
+  }
+  return ok;
+}
+
+static inline bool checkEqual(long a, long b, const char* text, const char* file, int line) {
+  checksRun++;
+  if (a != b) {
+    checksFailed++;
+    printf("%s:%d: CHECK failed: %s (%ld vs %ld)\n", file, line, text, a, b);
+  }
+  return a == b;
+}
+
+static inline int finish() {
+  printf("%d checks, %d failed\n", checksRun, checksFailed);
+  return checksFailed ? 1 : 0;
+}
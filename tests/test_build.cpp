@@ -0,0 +1,65 @@
+/*
+  test_build.cpp - drvBuild tables and their checks (request 047)
+
+  Builds the drvBuild.h usage example with DRV_BUILD_TABLE, so the header and
+  its static_asserts are compiled on every build, streams it into a drvSim
+  with loadTable() and checks the registers and the frame order (CTRL last).
+  errors() must give the right BUILD_ bits for configurations the table
+  macro would reject.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvTrace.h>
+#include <drvBuild.h>
+#include "check.h"
+
+constexpr drvBuild quiet = drvBuild()
+    .isGain(20).torque(0x80).limit(1500, 50)  // 1.5 A motor, 50 mOhm
+    .tOff(0x30).tBlank(0x80)
+    .decMode(DECMODE_MIXED).tDecay(0x10)
+    .ocpDeglitch(2100)
+    .enable(true);
+DRV_BUILD_TABLE(quietFrames, quiet);
+
+// register values the example comes to from the power on image
+static const unsigned int expected[8] = {0x201, 0x080, 0x130, 0x080, 0x310, 0x000, 0xFA5, 0x000};
+
+int main() {
+  drvSim sim;
+  drvTraceEntry ring[16];
+  TraceTransport trace(sim, ring, 16);
+  drv motor(0, trace);
+  trace.clear();
+
+  motor.loadTable(quietFrames, DRV_BUILD_FRAMES);
+  for (uint8_t i = 0; i < 7; i++) {
+    CHECK_EQ(sim.regs[i], expected[i]);
+    CHECK_EQ(quiet.reg(i), expected[i]);
+  }
+  CHECK_EQ(trace.count, DRV_BUILD_FRAMES);
+  for (uint16_t i = 0; i < trace.count; i++) {
+    CHECK_EQ(trace.entry(i).frame & 0x8000, 0); // writes only
+  }
+  CHECK_EQ(trace.entry(DRV_BUILD_FRAMES - 1).frame >> 12, motor.CTRL);
+  CHECK_EQ(quiet.errors(), 0);
+  CHECK_EQ(quiet.tripMilliamps(), 1375);
+
+  // what DRV_BUILD_TABLE would stop the build on
+  constexpr drvBuild blankOff = drvBuild().tOff(0x01).tBlank(0x80);
+  constexpr drvBuild gain = drvBuild().isGain(7);
+  constexpr drvBuild decayOff = drvBuild().decMode(DECMODE_MIXED).tOff(0x10).tDecay(0x20);
+  constexpr drvBuild current = drvBuild().isGain(5).torque(0xFF).limit(1500, 50);
+  static_assert(blankOff.errors() == BUILD_BLANK_OFF, "evaluated at compile time");
+  CHECK_EQ(blankOff.errors(), BUILD_BLANK_OFF);
+  CHECK_EQ(drvBuild().tOff(0).tBlank(0).errors(), BUILD_BLANK_OFF); // the 1 us minimum
+  CHECK_EQ(gain.errors(), BUILD_ISGAIN);
+  CHECK_EQ(decayOff.errors(), BUILD_DECAY_OFF);
+  CHECK_EQ(drvBuild().decMode(DECMODE_SLOW).tOff(0x10).tDecay(0x20).errors(), 0);
+  CHECK_EQ(current.errors(), BUILD_CURRENT);
+  CHECK_EQ(drvBuild().tOff(0x01).tBlank(0x80).isGain(7).errors(), BUILD_BLANK_OFF | BUILD_ISGAIN);
+  CHECK_EQ(drvBuild().decMode(4).errors(), BUILD_DECMODE);
+
+  return finish();
+}
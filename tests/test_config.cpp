@@ -0,0 +1,54 @@
+/*
+  test_config.cpp - saveConfig / restoreConfig through a FileConfigStore
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include "check.h"
+
+int main() {
+  FileConfigStore store("test_config.cfg");
+
+  drvSim first;
+  drv configured(0, first);
+  configured.getCurrentRegisters();
+  configured.setTorque(0x60);
+  configured.setTOff(0x20);
+  configured.setISGain(10);
+  configured.setHbridge("on");
+  CHECK(configured.saveConfig(store));
+
+  // a warm boot with the bridge off: three registers differ, ENBL is kept
+  drvSim second;
+  second.regs[0] &= ~0x001;
+  drv restored(0, second);
+  CHECK_EQ(restored.restoreConfig(store), 3);
+  CHECK_EQ(second.regs[restored.TORQUE] & 0xFF, 0x60);
+  CHECK_EQ(second.regs[restored.OFF] & 0xFF, 0x20);
+  CHECK_EQ((second.regs[restored.CTRL] >> 8) & 0x3, 1);
+  CHECK_EQ(second.regs[restored.CTRL] & 0x001, 0);
+
+  // nothing left to write, and the bridge is not switched on by a restore
+  unsigned long writes = second.writes;
+  CHECK_EQ(restored.restoreConfig(store), 0);
+  CHECK_EQ(second.writes, writes);
+
+  // once on, a restore leaves it on
+  restored.setHbridge("on");
+  CHECK_EQ(restored.restoreConfig(store), 0);
+  CHECK_EQ(second.regs[restored.CTRL] & 0x001, 1);
+
+  // a corrupted image is refused
+  FILE* f = fopen("test_config.cfg", "r+b");
+  CHECK(f != 0);
+  if (f) {
+    fseek(f, 6, SEEK_SET);
+    fputc(0x5A, f);
+    fclose(f);
+  }
+  CHECK_EQ(restored.restoreConfig(store), -1);
+  remove("test_config.cfg");
+
+  return finish();
+}
@@ -0,0 +1,59 @@
+/*
+  test_current.cpp - CurrentController against drvPlant (request 037)
+
+  The sense resistor fitted is 20% off nominal (0.06 ohm), so the open loop
+  TORQUE for 300 counts is wrong and the loop has to find it. The loop runs
+  one step per 600 us of plant time. It must settle within 2% (6 counts)
+  of the target in at most 45 steps and stay there, with one write frame
+  per TORQUE change and no reads; above lowSpeed DECMODE goes mixed.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvPlant.h>
+#include <drvCurrent.h>
+#include "check.h"
+
+#define STEPS 150
+#define BAND 6
+
+int main() {
+  drvSim sim;
+  drvPlant plant(sim);
+  drv motor(0, sim);
+  plant.rsense = 0.06;
+
+  CurrentController loop(motor, plant, 1000);
+  loop.setTarget(300);
+
+  int settled = -1;
+  unsigned long writes = sim.writes;
+  for (int i = 0; i < STEPS; i++) {
+    plant.advance(600);
+    loop.step();
+    int error = (int)loop.measured - 300;
+    if (error > BAND || error < -BAND) {
+      settled = -1;
+    } else if (settled < 0) {
+      settled = i + 1;
+    }
+  }
+  printf("settled within %d counts after %d steps, TORQUE %u, %lu frames\n",
+         BAND, settled, loop.torque, loop.frames);
+  CHECK(settled > 0);
+  CHECK(settled <= 45);
+  CHECK(loop.torque < 255);                  // no saturation at the end
+  CHECK_EQ(sim.writes - writes, loop.frames); // one write per change, no reads
+
+  // above lowSpeed the decay is held at mixed
+  loop.setSpeed(500);
+  for (int i = 0; i < CURRENT_RIPPLE_WINDOW; i++) {
+    plant.advance(600);
+    loop.step();
+  }
+  CHECK_EQ(loop.decMode, DECMODE_MIXED);
+  CHECK_EQ((sim.regs[motor.DECAY] >> 8) & 0x7, DECMODE_MIXED);
+
+  return finish();
+}
@@ -0,0 +1,127 @@
+/*
+  test_dc.cpp - DcMotor on a recording drvPwm (request 043)
+
+  configure() takes the PWM frequency from TOFF / TBLANK (DC_CHOPS chopper
+  cycles per PWM period, clamped to DC_MIN_HZ..DC_MAX_HZ) and the on time
+  floor from the blanking time. The duty follows the curve (interpolated)
+  through the slew ramp, the pins carry the fast / slow decay patterns in
+  both directions, and nothing after configure() touches SPI.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvPwm.h>
+#include <drvDc.h>
+#include "check.h"
+
+// remembers the last frequency asked for and the duty on channels 0 and 1
+class RecordingPwm : public drvPwm {
+    public:
+        RecordingPwm() { hz = 0; duty[0] = duty[1] = 0xFFFF; }
+        unsigned long setFrequency(unsigned long value) { hz = value; return value; }
+        void write(uint8_t channel, uint16_t value) { duty[channel & 1] = value; }
+        unsigned long hz;
+        uint16_t duty[2];
+};
+
+static unsigned long expectedHz(unsigned int toff, unsigned int tblank) {
+  double blank = tblank * 21.0 < 1000 ? 1000 : tblank * 21.0;
+  double hz = 1e9 / (DC_CHOPS * ((toff + 1) * 525.0 + blank));
+  return hz < DC_MIN_HZ ? DC_MIN_HZ : (hz > DC_MAX_HZ ? DC_MAX_HZ : (unsigned long)hz);
+}
+
+static void settle(DcMotor& motor) {
+  for (int i = 0; i < 200 && motor.speed != motor.target; i++) {
+    motor.update();
+  }
+}
+
+int main() {
+  drvSim sim;
+  drv driver(0, sim);
+  RecordingPwm pwm;
+  DcMotor motor(driver, pwm, 0, 1);
+
+  // frequency from the chopper timing, and both clamps
+  const unsigned int timing[3][2] = {{0x30, 0x80}, {0x00, 0x00}, {0xFF, 0xFF}};
+  for (uint8_t i = 0; i < 3; i++) {
+    sim.regs[2] = 0x100 | timing[i][0]; // OFF, PWMMODE kept
+    sim.regs[3] = timing[i][1];
+    CHECK_EQ(motor.configure(), expectedHz(timing[i][0], timing[i][1]));
+    CHECK_EQ(pwm.hz, motor.frequency);
+  }
+  CHECK_EQ(expectedHz(0x00, 0x00), DC_MAX_HZ);
+  CHECK_EQ(expectedHz(0xFF, 0xFF), DC_MIN_HZ);
+
+  // default timing: 4399 Hz, on time floor of two 2.688 us blanking times
+  sim.regs[2] = 0x130;
+  sim.regs[3] = 0x080;
+  CHECK_EQ(motor.configure(), 4399);
+  CHECK_EQ(motor.minDuty, 25);
+  unsigned long frames = sim.frames;
+
+  // slew: 16 per update up to the target, then held
+  motor.setSpeed(100);
+  int expected[] = {16, 32, 48, 64, 80, 96, 100, 100};
+  for (uint8_t i = 0; i < 8; i++) {
+    motor.update();
+    CHECK_EQ(motor.speed, expected[i]);
+  }
+  motor.setSpeed(5000);
+  CHECK_EQ(motor.target, PWM_FULL);
+
+  // linear curve, interpolated between the 17 points
+  motor.slew = PWM_FULL;
+  const int commands[] = {64, 100, 511, 700, 1000, PWM_FULL};
+  for (uint8_t i = 0; i < 6; i++) {
+    motor.setSpeed(commands[i]);
+    settle(motor);
+    CHECK(motor.duty <= commands[i] && commands[i] - motor.duty <= 1); // points round down
+  }
+
+  // a shaped curve: deadband to 300, then linear
+  for (uint8_t i = 1; i < DC_CURVE; i++) {
+    motor.curve[i] = 300 + (uint32_t)(i - 1) * (PWM_FULL - 300) / (DC_CURVE - 2);
+  }
+  motor.setSpeed(31); // 0.48 of the way to point 1: 300 * 0.48
+  settle(motor);
+  CHECK_EQ(motor.duty, 145);
+  motor.setSpeed(95); // 0.49 of the way from point 1 (300) to point 2 (348)
+  settle(motor);
+  CHECK_EQ(motor.duty, 323);
+  for (uint8_t i = 0; i < DC_CURVE; i++) {
+    motor.curve[i] = (uint32_t)i * PWM_FULL / (DC_CURVE - 1);
+  }
+
+  // on time floor, and off is off
+  motor.setSpeed(5);
+  settle(motor);
+  CHECK_EQ(motor.duty, motor.minDuty);
+  motor.setSpeed(0);
+  settle(motor);
+  CHECK_EQ(motor.duty, 0);
+
+  // pin patterns: fast decay coasts, slow decay brakes, in both directions
+  motor.setMode(DC_FAST);
+  motor.setSpeed(PWM_FULL / 2);
+  settle(motor);
+  uint16_t duty = motor.duty;
+  CHECK_EQ(pwm.duty[0], duty);
+  CHECK_EQ(pwm.duty[1], 0);
+  motor.setSpeed(-PWM_FULL / 2);
+  settle(motor);
+  CHECK_EQ(pwm.duty[0], 0);
+  CHECK_EQ(pwm.duty[1], duty);
+  motor.setMode(DC_SLOW);
+  CHECK_EQ(pwm.duty[0], PWM_FULL - duty);
+  CHECK_EQ(pwm.duty[1], PWM_FULL);
+  motor.setSpeed(PWM_FULL / 2);
+  settle(motor);
+  CHECK_EQ(pwm.duty[0], PWM_FULL);
+  CHECK_EQ(pwm.duty[1], PWM_FULL - duty);
+
+  CHECK_EQ(sim.frames, frames); // PWM only after configure()
+
+  return finish();
+}
@@ -0,0 +1,64 @@
+/*
+  test_driver.cpp - setters, getters and batching through SimSpidev
+
+  The default host path: drv -> SpidevTransport -> SPI_IOC_MESSAGE, with the
+  ioctl answered by a drvSim.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvSpidev.h>
+#include "check.h"
+
+int main() {
+  drvSim sim;
+  SimSpidev bus(sim);
+  drv motor(0, bus);
+
+  // setters reach the device and read back
+  CHECK(motor.setTorque(100));
+  CHECK_EQ(sim.regs[motor.TORQUE] & 0xFF, 100);
+  CHECK(motor.setISGain(10));
+  CHECK_EQ((sim.regs[motor.CTRL] >> 8) & 0x3, 1);
+  CHECK(motor.setDecMode("mixed"));
+  CHECK_EQ((sim.regs[motor.DECAY] >> 8) & 0x7, 3);
+  CHECK(motor.setHbridge("on"));
+  CHECK_EQ(motor.getTorque(), 100u);
+  CHECK_EQ(motor.getISGain(), 10);
+
+  // invalid input leaves the device alone
+  unsigned long writes = sim.writes;
+  CHECK(!motor.setISGain(7));
+  CHECK_EQ(sim.writes, writes);
+
+  // a batch is one ioctl, SCS released between the frames
+  unsigned long messages = bus.messages;
+  unsigned int frames[4] = {0x8000, 0x9000, 0xA000, 0xB000};
+  unsigned int responses[4];
+  motor.transfer(frames, responses, 4);
+  CHECK_EQ(bus.messages - messages, 1);
+  CHECK_EQ(responses[1], sim.regs[motor.TORQUE]);
+  CHECK_EQ(sim.unselectedFrames, 0);
+
+  // getCurrentRegisters fills the shadow from the device
+  sim.regs[motor.OFF] = 0x155;
+  motor.getCurrentRegisters();
+  CHECK_EQ(motor.currentRegisterValues[motor.OFF], 0x155);
+
+  // writeVerified reads back in the same batch
+  unsigned int verify[2] = {(unsigned int)(motor.BLANK << 12) | 0x0A0,
+                            (unsigned int)(motor.DRIVE << 12) | 0xFA5};
+  messages = bus.messages;
+  CHECK_EQ(motor.writeVerified(verify, 2), 0);
+  CHECK_EQ(bus.messages - messages, 1);
+  CHECK_EQ(sim.regs[motor.BLANK], 0x0A0);
+
+  // MISO held high is caught by the link checks
+  sim.stuckMiso = 1;
+  motor.read(motor.TORQUE);
+  CHECK(motor.link.stuckHigh > 0);
+  sim.stuckMiso = -1;
+
+  return finish();
+}
@@ -0,0 +1,113 @@
+/*
+  test_idle.cpp - IdleManager on drvSim under a VirtualClock (request 045)
+
+  TORQUE 0xFF (ISGAIN 5, 0.05 ohm, 4 ohm coils) parked at 0x30 for a second
+  saves about 14.5 J by the both coils estimate. Going idle and restoring
+  take one batch each, two frames with idleDecMode set and one without, a
+  TORQUE set between restores is what the next restore puts back, and
+  TORQUE / DECMODE written while idle are kept.
+
+*/
+#include <Arduino.h>
+#include <math.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvClock.h>
+#include <drvIdle.h>
+#include "check.h"
+
+#if DRV_STATS
+class Buffer : public Print {
+    public:
+        uint8_t data[STATS_EXPORT_SIZE + 8];
+        unsigned int len;
+        Buffer() { len = 0; }
+        size_t write(uint8_t c) { if (len < sizeof(data)) data[len++] = c; return 1; }
+        using Print::write;
+};
+#endif
+
+int main() {
+  VirtualClock clock;
+  clock.install();
+  drvSim sim;
+  drv motor(0, sim);
+  motor.setLogging("off");
+  motor.updateTorque(0xFF);
+  unsigned int torque = sim.regs[motor.TORQUE];
+  unsigned int decay = sim.regs[motor.DECAY];
+
+  IdleManager parking(motor, 50);
+  parking.idleTorque = 0x30;
+  parking.idleDecMode = 0;
+  parking.begin();
+
+  unsigned long frames = sim.frames;
+  CHECK(!parking.activity());
+  delay(20);
+  CHECK(!parking.poll());
+  CHECK_EQ(sim.frames - frames, 0);
+
+  delay(40);
+  CHECK(parking.poll());
+  CHECK_EQ(sim.frames - frames, 2);
+  CHECK_EQ(sim.regs[motor.TORQUE] & 0xFF, 0x30);
+  CHECK_EQ((sim.regs[motor.DECAY] >> 8) & 0x7, 0);
+
+  delay(1000);
+  frames = sim.frames;
+  CHECK(parking.activity());
+  CHECK_EQ(sim.frames - frames, 2);
+  CHECK_EQ(sim.regs[motor.TORQUE], torque);
+  CHECK_EQ(sim.regs[motor.DECAY], decay);
+  printf("idle %lu ms, saved %.2f J\n", parking.idleMillis, parking.savedJoules);
+  CHECK_EQ(parking.periods, 1);
+  CHECK(parking.idleMillis >= 1000 && parking.idleMillis <= 1001);
+  CHECK(fabs(parking.savedJoules - 14.5) < 0.1);
+
+  // a TORQUE set while running is what comes back after the next idle period
+  motor.updateTorque(0x80);
+  delay(60);
+  CHECK(parking.poll());
+  CHECK_EQ(sim.regs[motor.TORQUE] & 0xFF, 0x30);
+  CHECK(parking.activity());
+  CHECK_EQ(sim.regs[motor.TORQUE] & 0xFF, 0x80);
+  CHECK_EQ(motor.currentRegisterValues[motor.TORQUE] & 0xFF, 0x80);
+
+  // written while idle: kept by the restore, the untouched field comes back
+  delay(60);
+  CHECK(parking.poll());
+  motor.updateTorque(0x90);
+  CHECK(parking.activity());
+  CHECK_EQ(sim.regs[motor.TORQUE] & 0xFF, 0x90);
+  CHECK_EQ(sim.regs[motor.DECAY], decay);
+  delay(60);
+  CHECK(parking.poll());
+  motor.updateDecMode(3); // mixed
+  CHECK(parking.activity());
+  CHECK_EQ(sim.regs[motor.TORQUE] & 0xFF, 0x90);
+  CHECK_EQ((sim.regs[motor.DECAY] >> 8) & 0x7, 3);
+  CHECK_EQ(sim.regs[motor.DECAY] & 0xFF, decay & 0xFF);
+
+  // DECMODE left alone: one frame each way
+  parking.idleDecMode = IDLE_KEEP;
+  delay(60);
+  frames = sim.frames;
+  CHECK(parking.poll());
+  CHECK_EQ(sim.frames - frames, 1);
+  CHECK(parking.activity());
+  CHECK_EQ(sim.frames - frames, 2);
+  CHECK_EQ(parking.periods, 5);
+
+#if DRV_STATS
+  Buffer out;
+  motor.stats.exportBinary(out);
+  drvStats decoded;
+  CHECK(drvStatsDecode(out.data, out.len, decoded));
+  CHECK_EQ(decoded.idle.periods, 5);
+  CHECK_EQ(decoded.idle.millis, parking.idleMillis);
+  CHECK(fabs(decoded.idle.millijoules / 1000.0 - parking.savedJoules) < 0.01);
+#endif
+
+  return finish();
+}
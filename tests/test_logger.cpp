@@ -0,0 +1,186 @@
+/*
+  test_logger.cpp - Logger levels, the RamSink buffer, logSet storm
+  suppression and the sink rate limit (time from a VirtualClock)
+
+*/
+#include <Arduino.h>
+#include <Logger.h>
+#include <drvClock.h>
+#include "check.h"
+
+// counts the lines it gets
+class CountingSink : public LogSink {
+    public:
+        CountingSink(uint8_t level) : LogSink(level) { lines = 0; }
+        void write(const char* line, uint8_t len) { (void)line; (void)len; lines++; }
+        int lines;
+};
+
+// collects a RamSink dump
+struct Capture : public Print {
+    char text[512];
+    size_t len;
+    Capture() { len = 0; }
+    size_t write(uint8_t c) { if (len < sizeof(text) - 1) text[len++] = c; return 1; }
+    using Print::write;
+
+    // occurrences of needle in the dump of ram
+    int count(RamSink& ram, const char* needle) {
+        len = 0;
+        ram.dump(*this);
+        text[len] = '\0';
+        int n = 0;
+        for (const char* p = strstr(text, needle); p; p = strstr(p + 1, needle)) {
+            n++;
+        }
+        return n;
+    }
+};
+
+// the same logSet line over and over: printed once, then one summary per
+// LOGGER_DEDUP_PERIOD, and flush() lets a pending summary out
+static void dedup() {
+  static char ctrl[] = "CTRL";
+  static char enbl[] = "ENBL";
+  static char memory[512];
+  VirtualClock clock;
+  clock.install();
+  Logger log("TEST", "info");
+  RamSink ram(memory, sizeof(memory), LOG_INFO);
+  ram.clear();
+  log.addSink(&ram);
+  Capture out;
+
+  for (int i = 0; i < 10; i++) {
+    log.logSet(ctrl, enbl, "on", true);
+    delay(50);
+  }
+  CHECK_EQ(out.count(ram, "ENBL subregister, on write success\n"), 1);
+  CHECK_EQ(out.count(ram, "repeated"), 0);
+
+  // the next repeat after the period carries the summary instead of the line
+  delay(LOGGER_DEDUP_PERIOD);
+  log.logSet(ctrl, enbl, "on", true);
+  CHECK_EQ(out.count(ram, "ENBL subregister, write success repeated 10 times\n"), 1);
+  CHECK_EQ(out.count(ram, "repeated"), 1);
+  CHECK_EQ(out.count(ram, "on write success\n"), 1);
+
+  // a storm that stops: nothing until the period is over, then flush()
+  for (int i = 0; i < 5; i++) {
+    log.logSet(ctrl, enbl, "on", true);
+  }
+  log.flush();
+  CHECK_EQ(out.count(ram, "repeated"), 1);
+  delay(LOGGER_DEDUP_PERIOD);
+  log.flush();
+  CHECK_EQ(out.count(ram, "write success repeated 5 times\n"), 1);
+  log.flush();
+  delay(LOGGER_DEDUP_PERIOD);
+  log.flush();
+  CHECK_EQ(out.count(ram, "repeated"), 2);
+
+  // a different outcome is its own key
+  log.logSet(ctrl, enbl, "on", false);
+  CHECK_EQ(out.count(ram, "ENBL subregister, on write fail\n"), 1);
+  VirtualClock::uninstall();
+}
+
+// setRateLimit(5, 2): a burst is cut at 5 lines, then 2 lines/s come back
+static void rateLimit() {
+  VirtualClock clock;
+  clock.install();
+  Logger log("TEST", "info");
+  CountingSink uart(LOG_INFO);
+  uart.setRateLimit(5, 2);
+  log.addSink(&uart);
+
+  for (int i = 0; i < 12; i++) {
+    log.logi("burst");
+  }
+  CHECK_EQ(uart.lines, 5);
+  CHECK_EQ(uart.dropped, 7);
+
+  delay(400); // not a whole token yet
+  log.logi("too early");
+  CHECK_EQ(uart.lines, 5);
+  delay(100); // 500 ms: one token
+  log.logi("one");
+  log.logi("none left");
+  CHECK_EQ(uart.lines, 6);
+  CHECK_EQ(uart.dropped, 9);
+
+  delay(1500); // three tokens, the remainder of the earlier interval kept
+  for (int i = 0; i < 5; i++) {
+    log.logi("refilled");
+  }
+  CHECK_EQ(uart.lines, 9);
+
+  delay(60000); // never more than the burst
+  for (int i = 0; i < 10; i++) {
+    log.logi("capped");
+  }
+  CHECK_EQ(uart.lines, 14);
+  CHECK_EQ(uart.dropped, 16);
+  VirtualClock::uninstall();
+}
+
+int main() {
+  // setLevel is the global ceiling, it leaves the sink levels alone
+  Logger log("TEST", "info");
+  CountingSink errors(LOG_ERROR);
+  CountingSink everything(LOG_INFO);
+  log.addSink(&errors);
+  log.addSink(&everything);
+
+  log.setLevel("error");
+  CHECK_EQ(errors.level, LOG_ERROR);
+  CHECK_EQ(everything.level, LOG_INFO);
+  log.logi("filtered by the global level");
+  log.loge("to both");
+  CHECK_EQ(errors.lines, 1);
+  CHECK_EQ(everything.lines, 1);
+
+  log.setLevel("info");
+  log.logi("to the info sink only");
+  CHECK_EQ(errors.lines, 1);
+  CHECK_EQ(everything.lines, 2);
+
+  log.setLevel("off");
+  log.loge("nowhere");
+  CHECK_EQ(errors.lines, 1);
+
+  // logSet passes the outcome through, printed or not
+  CHECK(log.logSet("CTRL", "ENBL", "on", true));
+  CHECK(!log.logSet("CTRL", "ENBL", "on", false));
+  CHECK_EQ(errors.lines + everything.lines, 3);
+  log.setLevel("info");
+  CHECK(log.logSet("TORQUE", "TORQUE", 100, true));
+  CHECK_EQ(everything.lines, 3);
+
+  // RamSink on a buffer at an odd address, kept across a second RamSink
+  // over the same memory (a reset with a NOINIT buffer)
+  static char memory[129];
+  char* odd = memory + 1;
+  {
+    Logger ramLog("TEST", "info");
+    RamSink ram(odd, 128, LOG_INFO);
+    ramLog.addSink(&ram);
+    for (int i = 0; i < 10; i++) {
+      ramLog.logi("a line long enough to wrap the buffer");
+    }
+  }
+  RamSink again(odd, 128, LOG_INFO);
+  Capture out;
+  again.dump(out);
+  out.text[out.len] = '\0';
+  CHECK(out.len > 0);
+  CHECK(strstr(out.text, "TEST - INFO: a line long enough to wrap the buffer\n") != 0);
+  again.clear();
+  out.len = 0;
+  again.dump(out);
+  CHECK_EQ(out.len, 0);
+
+  dedup();
+  rateLimit();
+  return finish();
+}
@@ -0,0 +1,101 @@
+/*
+  test_motion.cpp - MotionPlanner step intervals (request 042)
+
+  A four move sequence, the last queued while the first is being stepped,
+  must end on its target, pass the junctions where the direction holds at
+  the planned junction speed instead of stopping, stop where it reverses,
+  and keep the rate and acceleration of the moves (measured over 32 step
+  windows, the per step ramp approximation is coarser than that). A long
+  move at MOTION_MAX_RATE must take within 1% of the ideal trapezoid time.
+
+*/
+#include <Arduino.h>
+#include <math.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvMotion.h>
+#include "check.h"
+
+#define WINDOW 32
+
+static void sequence() {
+  drvSim sim;
+  drv motor(0, sim);
+  drvStepper coils(motor, 2, 3, 4, 5, true);
+  MotionPlanner planner(coils);
+  CHECK(planner.queue(4000, 3000, 8000));
+  CHECK(planner.queue(6000, 2000, 8000));
+  CHECK(planner.queue(0, 3000, 8000));
+
+  unsigned long interval;
+  long steps = 0;
+  double elapsed = 0, window = 0, lastWindow = 0, lastRate = 0;
+  double peakRate = 0, peakAccel = 0;
+  // slowest step rate within 4 steps of each junction: 4000 (same direction,
+  // 3000 -> 2000 steps/s), 6000 (reversal), 0 on the way back (same
+  // direction, but the 500 step last move can only brake from
+  // sqrt(2 * 8000 * 500) = 2828 steps/s; the start at 0 does not count)
+  const long junctions[3] = {4000, 6000, 0};
+  double slowest[3] = {1e9, 1e9, 1e9};
+  int n = 0;
+  while ((interval = planner.step())) {
+    for (uint8_t j = 0; j < 3; j++) {
+      if (labs(planner.position - junctions[j]) <= 4 && steps > 1000 && 1e6 / interval < slowest[j]) {
+        slowest[j] = 1e6 / interval;
+      }
+    }
+    steps++;
+    elapsed += interval;
+    window += interval;
+    if (++n == WINDOW) {
+      double rate = WINDOW * 1e6 / window;
+      peakRate = rate > peakRate ? rate : peakRate;
+      if (lastRate > 0) {
+        double accel = fabs(rate - lastRate) / ((window + lastWindow) * 0.5e-6);
+        peakAccel = accel > peakAccel ? accel : peakAccel;
+      }
+      lastRate = rate;
+      lastWindow = window;
+      window = 0;
+      n = 0;
+    }
+    if (steps == 1000) {
+      CHECK(planner.queue(-500, 3000, 8000));
+    }
+  }
+  printf("sequence: %ld steps in %.3f s, peak %.0f steps/s, %.0f steps/s^2\n",
+         steps, elapsed / 1e6, peakRate, peakAccel);
+  printf("junctions: %.0f / %.0f / %.0f steps/s\n", slowest[0], slowest[1], slowest[2]);
+  CHECK_EQ(planner.position, -500);
+  CHECK(peakRate <= 3000 * 1.02);
+  CHECK(peakAccel <= 8000 * 1.15);
+  CHECK(slowest[0] >= 2000 * 0.95); // lookahead: no stop where the direction holds
+  CHECK(slowest[1] <= 200);         // a reversal stops
+  CHECK(slowest[2] >= 2828 * 0.95);
+}
+
+static void fast() {
+  drvSim sim;
+  drv motor(0, sim);
+  drvStepper coils(motor, 2, 3, 4, 5, true);
+  MotionPlanner planner(coils);
+  CHECK(!planner.queue(1000, MOTION_MAX_RATE + 1, 60000));
+  CHECK(planner.queue(200000, MOTION_MAX_RATE, 60000));
+
+  unsigned long interval;
+  double elapsed = 0;
+  while ((interval = planner.step())) {
+    elapsed += interval;
+  }
+  // cruise plus one accelerate and one brake ramp: d / v + v / a
+  double ideal = 200000.0 / MOTION_MAX_RATE + (double)MOTION_MAX_RATE / 60000;
+  printf("fast: %.3f s, ideal %.3f s\n", elapsed / 1e6, ideal);
+  CHECK_EQ(planner.position, 200000);
+  CHECK(fabs(elapsed / 1e6 - ideal) <= ideal * 0.01);
+}
+
+int main() {
+  sequence();
+  fast();
+  return finish();
+}
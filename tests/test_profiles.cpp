@@ -0,0 +1,70 @@
+/*
+  test_profiles.cpp - switchProfile with a known and an unknown device state,
+  and after a brown out reset the device
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include "check.h"
+
+static bool matches(drvSim& sim, uint8_t id) {
+  for (uint8_t i = 0; i < PROFILE_REGS; i++) {
+    unsigned int mask = i == 0 ? 0xFFE : 0xFFF; // ENBL is not part of a profile
+    if (i != 0x5 && (sim.regs[i] & mask) != (drvProfiles[id].regs[i] & mask)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  drvSim sim;
+  {
+    drv before(0, sim);
+    CHECK(before.switchProfile(PROFILE_HOLD));
+    CHECK(matches(sim, PROFILE_HOLD));
+    before.setHbridge("off");
+  }
+
+  // MCU reset, DRV8704 still powered: the new shadow holds the power on
+  // defaults, which agree with PROFILE_RUN's TORQUE while the device does not
+  drv motor(0, sim);
+  unsigned long reads = sim.reads;
+  CHECK(motor.switchProfile(PROFILE_RUN));
+  CHECK(matches(sim, PROFILE_RUN));
+  CHECK_EQ(sim.regs[motor.CTRL] & 0x001, 0); // the bridge stays off
+  CHECK(sim.reads > reads);
+
+  // known state: deltas only, no reads
+  reads = sim.reads;
+  unsigned long writes = sim.writes;
+  CHECK(motor.switchProfile(PROFILE_BRAKE));
+  CHECK(matches(sim, PROFILE_BRAKE));
+  CHECK_EQ(sim.reads, reads);
+  CHECK_EQ(sim.writes - writes, 3); // TORQUE, OFF, DECAY
+
+  // after a getter read everything back, the unknown state path reads nothing
+  motor.getCurrentRegisters();
+  motor.activeProfile = PROFILE_NONE;
+  reads = sim.reads;
+  CHECK(motor.switchProfile(PROFILE_HOLD));
+  CHECK(matches(sim, PROFILE_HOLD));
+  CHECK_EQ(sim.reads, reads);
+
+  // brown out: the device is back at power on values, seen as UVLO in STATUS;
+  // re-asserting HOLD by its (empty) delta would leave TORQUE at reset
+  sim.reset();
+  sim.raiseFault(0x20);
+  motor.read(motor.STATUS);
+  CHECK_EQ(motor.activeProfile, PROFILE_NONE);
+  CHECK(motor.switchProfile(PROFILE_HOLD));
+  for (uint8_t i = 0; i < PROFILE_REGS; i++) {
+    unsigned int mask = i == 0 ? 0xFFE : 0xFFF;
+    if (i != 0x5) {
+      CHECK_EQ(sim.regs[i] & mask, drvProfiles[PROFILE_HOLD].regs[i] & mask);
+    }
+  }
+
+  return finish();
+}
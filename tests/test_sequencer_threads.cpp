@@ -0,0 +1,132 @@
+/*
+  test_sequencer_threads.cpp - Sequencer under real concurrency
+
+  One std::thread per priority class submits write / read pairs to its own
+  register while an owner thread services the queues against a drvSim, the
+  way a fault ISR, a control timer and loop() share the bus on a board.
+  Every read must return the value written just before it in the same
+  class (ordering within a class, nothing lost or duplicated), and the
+  submit to completion latency seen by each class is reported as p50 / p99
+  / max.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <Sequencer.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include "check.h"
+
+#define PAIRS 20000
+
+static uint64_t nanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+struct Producer {
+    uint8_t priority;
+    unsigned int address;
+    unsigned long wrong;
+    unsigned long full;
+    std::vector<uint32_t> latency;  // ns per pair
+};
+
+static void produce(Sequencer* bus, drv* motor, Producer* p) {
+  p->latency.reserve(PAIRS);
+  for (unsigned int i = 0; i < PAIRS; i++) {
+    unsigned int value = (i * 7 + p->priority) & 0xFFF;
+    uint64_t start = nanos();
+    while (bus->submitWrite(motor, p->address, value, p->priority) < 0) {
+      p->full++;
+      std::this_thread::yield();
+    }
+    int ticket;
+    while ((ticket = bus->submitRead(motor, p->address, p->priority)) < 0) {
+      p->full++;
+      std::this_thread::yield();
+    }
+    unsigned int response;
+    while (!bus->poll(p->priority, ticket, &response)) {
+      std::this_thread::yield();
+    }
+    p->latency.push_back((uint32_t)(nanos() - start));
+    if ((response & 0xFFF) != value) {
+      p->wrong++;
+    }
+  }
+}
+
+int main() {
+  drvSim sim;
+  drv motor(0, sim);
+  Sequencer bus;
+
+  // single threaded: a class holds SEQ_DEPTH frames, polling frees them
+  int ticket = -1;
+  for (int i = 0; i < SEQ_DEPTH; i++) {
+    ticket = bus.submitRead(&motor, motor.TORQUE, SEQ_DIAG);
+    CHECK(ticket >= 0);
+  }
+  CHECK_EQ(bus.submitRead(&motor, motor.TORQUE, SEQ_DIAG), -1);
+  CHECK_EQ(bus.service(SEQ_ALL), SEQ_DEPTH);
+  CHECK(bus.poll(SEQ_DIAG, ticket, 0));
+  CHECK(bus.submitRead(&motor, motor.TORQUE, SEQ_DIAG) >= 0);
+  bus.service(SEQ_ALL);
+
+  // one producer thread per class, each on its own register
+  const unsigned int addresses[SEQ_CLASSES] = {0x2, 0x3, 0x4, 0x6}; // OFF, BLANK, DECAY, DRIVE
+  Producer producers[SEQ_CLASSES];
+  for (uint8_t i = 0; i < SEQ_CLASSES; i++) {
+    producers[i].priority = i;
+    producers[i].address = addresses[i];
+    producers[i].wrong = 0;
+    producers[i].full = 0;
+  }
+
+  unsigned long framesBefore = sim.frames;
+  std::atomic<bool> stop(false);
+  unsigned long serviced = 0;
+  std::thread owner([&]() {
+    while (!stop.load()) {
+      unsigned int sent = bus.service(SEQ_ALL);
+      serviced += sent;
+      if (!sent) {
+        std::this_thread::yield();
+      }
+    }
+    serviced += bus.service(SEQ_ALL);
+  });
+
+  std::vector<std::thread> threads;
+  for (uint8_t i = 0; i < SEQ_CLASSES; i++) {
+    threads.push_back(std::thread(produce, &bus, &motor, &producers[i]));
+  }
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+  stop.store(true);
+  owner.join();
+
+  const char* names[SEQ_CLASSES] = {"fault", "control", "config", "diag"};
+  for (uint8_t i = 0; i < SEQ_CLASSES; i++) {
+    Producer& p = producers[i];
+    CHECK_EQ(p.wrong, 0);
+    CHECK_EQ(p.latency.size(), PAIRS);
+    CHECK_EQ(bus.pending(i), 0);
+    std::sort(p.latency.begin(), p.latency.end());
+    printf("%-8s p50 %6u ns  p99 %8u ns  max %9u ns  full %lu  high water %u\n", names[i],
+           p.latency[p.latency.size() / 2], p.latency[p.latency.size() * 99 / 100],
+           p.latency.back(), p.full, bus.highWater[i]);
+  }
+  CHECK_EQ(serviced, 2UL * PAIRS * SEQ_CLASSES);
+  CHECK_EQ(sim.frames - framesBefore, 2UL * PAIRS * SEQ_CLASSES);
+  CHECK_EQ(sim.unselectedFrames, 0);
+
+  return finish();
+}
@@ -0,0 +1,50 @@
+/*
+  test_shadow.cpp - raw write frames keep the shadow honest
+
+  Frames that bypass write() (Sequencer::submitWrite, drvStepper TORQUE
+  tables, writeFrames) must still move the shadow and drop its trust, or a
+  later setter or update() would work from the old value.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <Sequencer.h>
+#include "check.h"
+
+int main() {
+  drvSim sim;
+  drv motor(0, sim);
+  Sequencer bus;
+
+  motor.getCurrentRegisters(); // everything trusted
+  CHECK(motor.switchProfile(PROFILE_RUN));
+
+  // SMPLTH (TORQUE bits 10-8) changed behind the setters' back
+  int ticket = bus.submitWrite(&motor, motor.TORQUE, 0x350, SEQ_CONTROL);
+  CHECK(ticket >= 0);
+  CHECK_EQ(bus.service(SEQ_ALL), 1);
+  CHECK_EQ(motor.currentRegisterValues[motor.TORQUE], 0x350);
+  CHECK_EQ(motor.activeProfile, PROFILE_NONE);
+
+  // the setter keeps it
+  CHECK(motor.setTorque(0x80));
+  CHECK_EQ(sim.regs[motor.TORQUE], 0x380);
+
+  // update() compares against what was really sent
+  bus.submitWrite(&motor, motor.TORQUE, 0x340, SEQ_CONTROL);
+  bus.service(SEQ_ALL);
+  unsigned long writes = sim.writes;
+  CHECK(motor.updateTorque(0x80));
+  CHECK_EQ(sim.writes - writes, 1);
+  CHECK_EQ(sim.regs[motor.TORQUE], 0x380);
+
+  // a raw batch too
+  unsigned int frames[1] = {(unsigned int)(motor.OFF << 12) | 0x020};
+  motor.transfer(frames, 0, 1);
+  CHECK_EQ(motor.currentRegisterValues[motor.OFF], 0x020);
+  CHECK(motor.setTOff(0x40));
+  CHECK_EQ(sim.regs[motor.OFF], 0x040);
+
+  return finish();
+}
@@ -0,0 +1,118 @@
+/*
+  test_soak.cpp - a day of operation under a VirtualClock (request 046)
+
+  24 h of virtual time: a FaultRecoveryTask pass every 100 ms, an
+  IdleManager parking the motor between moves 1..61 s apart, AOCP raised
+  with a mean interval of 10 min and UVLO of 1 h, SPI timed by a
+  ClockedTransport. Every fault must be seen and cleared with the bridge
+  back on, and the run must repeat exactly for the same seed and differ for
+  another. Takes a few seconds of wall time per run.
+
+*/
+#include <Arduino.h>
+#include <time.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvClock.h>
+#include <drvIdle.h>
+#include <drvTask.h>
+#include "check.h"
+
+#define DAY 86400000000ULL
+
+struct Soak {
+    drvSim sim;
+    unsigned long raised;
+    unsigned long seen;
+    unsigned long moves;
+    unsigned long frames;
+    unsigned long idleMillis;
+    unsigned int status;
+    unsigned int ctrl;
+};
+
+static unsigned long overcurrent(void* context) {
+  Soak* soak = (Soak*)context;
+  soak->sim.raiseFault(0x02);
+  soak->raised++;
+  return VirtualClock::installed->exponential(600000000UL);
+}
+
+static unsigned long undervoltage(void* context) {
+  Soak* soak = (Soak*)context;
+  soak->sim.raiseFault(0x20);
+  soak->raised++;
+  return VirtualClock::installed->exponential(3600000000UL);
+}
+
+static void run(uint32_t seed, Soak& soak) {
+  clock_t wall = clock();
+  VirtualClock time(seed);
+  time.install();
+  ClockedTransport bus(soak.sim, time);
+  drv motor(0, bus);
+  motor.setLogging("off");
+  motor.getCurrentRegisters();
+
+  IdleManager parking(motor, 500);
+  parking.idleTorque = 0x30;
+  parking.begin();
+  FaultRecoveryTask recovery(&motor);
+  time.after(time.exponential(600000000UL), overcurrent, &soak);
+  time.after(time.exponential(3600000000UL), undervoltage, &soak);
+
+  soak.raised = 0;
+  soak.seen = 0;
+  soak.moves = 0;
+  unsigned long checked = 0;
+  unsigned long move = 0;
+  while (time.now() < DAY) {
+    unsigned long now = millis();
+    if (now - checked >= 100) {
+      checked = now;
+      recovery.restart();
+      while (recovery.poll() == TASK_RUNNING) {
+      }
+      if (motor.faults[1] || motor.faults[5]) {
+        soak.seen++;
+      }
+    }
+    if ((long)(now - move) >= 0) {
+      parking.activity();
+      soak.moves++;
+      move = now + 1000 + random(60000);
+    }
+    parking.poll();
+    delay(10);
+  }
+  soak.frames = soak.sim.frames;
+  soak.idleMillis = parking.idleMillis;
+  soak.status = soak.sim.regs[motor.STATUS];
+  soak.ctrl = soak.sim.regs[motor.CTRL];
+  printf("seed %u: %lu frames, %lu faults raised, %lu seen, %lu moves, idle %.1f h, %.2f s wall\n",
+         seed, soak.frames, soak.raised, soak.seen, soak.moves, soak.idleMillis / 3.6e6,
+         (double)(clock() - wall) / CLOCKS_PER_SEC);
+  VirtualClock::uninstall();
+}
+
+int main() {
+  Soak first, again, other;
+  run(42, first);
+  CHECK(first.raised > 100);
+  CHECK_EQ(first.seen, first.raised);
+  CHECK_EQ(first.status, 0);
+  CHECK(first.ctrl & 0x001);
+  CHECK(first.moves > 2000);
+
+  run(42, again);
+  CHECK_EQ(again.frames, first.frames);
+  CHECK_EQ(again.raised, first.raised);
+  CHECK_EQ(again.moves, first.moves);
+  CHECK_EQ(again.idleMillis, first.idleMillis);
+
+  run(7, other);
+  CHECK_EQ(other.seen, other.raised);
+  CHECK(other.frames != first.frames || other.raised != first.raised);
+
+  return finish();
+}
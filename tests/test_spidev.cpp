@@ -0,0 +1,70 @@
+/*
+  test_spidev.cpp - one SpidevTransport shared by drv objects on two selects
+
+  Each select keeps its own device: opened once, and every frame, single or
+  batched, goes to the device of the drv that sent it.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvSpidev.h>
+#include "check.h"
+
+// a drvSim per chip select, the file descriptor is the select
+class TwoSelects : public SpidevTransport {
+    public:
+        drvSim sims[2];
+        int opens;
+
+        TwoSelects() { opens = 0; }
+
+    protected:
+        int openDevice(const char* path) {
+            opens++;
+            return path[strlen(path) - 1] - '0';
+        }
+
+        bool message(int file, struct spi_ioc_transfer* transfers, uint8_t count) {
+            for (uint8_t i = 0; i < count; i++) {
+                const uint8_t* tx = (const uint8_t*)(unsigned long)transfers[i].tx_buf;
+                uint8_t* rx = (uint8_t*)(unsigned long)transfers[i].rx_buf;
+                sims[file].open(0);
+                unsigned int response = sims[file].transfer16((tx[0] << 8) | tx[1]);
+                sims[file].close(0);
+                rx[0] = response >> 8;
+                rx[1] = response & 0xFF;
+            }
+            return true;
+        }
+};
+
+int main() {
+  TwoSelects bus;
+  drv first(0, bus);
+  drv second(1, bus);
+
+  // alternating single frames
+  for (int i = 0; i < 4; i++) {
+    CHECK(first.setTorque(10 + i));
+    CHECK(second.setTorque(100 + i));
+  }
+  CHECK_EQ(bus.sims[0].regs[first.TORQUE] & 0xFF, 13);
+  CHECK_EQ(bus.sims[1].regs[second.TORQUE] & 0xFF, 103);
+  CHECK_EQ(bus.opens, 2); // no reopening when the select changes
+
+  // batches go to the select they were sent for
+  unsigned long frames0 = bus.sims[0].frames;
+  unsigned long frames1 = bus.sims[1].frames;
+  unsigned int batch[3] = {0x2000 | 0x011, 0x3000 | 0x022, 0x8000};
+  second.transfer(batch, 0, 3);
+  CHECK_EQ(bus.sims[0].frames, frames0);
+  CHECK_EQ(bus.sims[1].frames - frames1, 3);
+  CHECK_EQ(bus.sims[1].regs[second.OFF], 0x011);
+  CHECK(bus.sims[0].regs[first.OFF] != 0x011);
+
+  CHECK_EQ(first.getTorque(), 13u);
+  CHECK_EQ(second.getTorque(), 103u);
+
+  return finish();
+}
@@ -0,0 +1,102 @@
+/*
+  test_stall.cpp - HomingTask against drvPlant (request 044)
+
+  The rotor starts 0..1500 steps from a stop (on it, and inside the 48 step
+  learning window) and homes towards it at 1000 to 1600 steps/s, the plant stepped through drvStepper::onStep. Every run
+  must flag the stall within 2 steps of the rotor meeting the stop, with
+  home on the stop itself; without a stop 5000 steps must pass with no
+  stall. The plant stop holds the rotor from either side.
+
+*/
+#include <Arduino.h>
+#include <limits.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvPlant.h>
+#include <drvStall.h>
+#include "check.h"
+
+struct Run {
+    uint8_t result;
+    long latency;   // steps from the first blocked step to the stall, -1 none
+    long home;      // error against the stop, steps
+    long steps;
+};
+
+static Run homing(long distance, float rate, bool stop) {
+  drvSim sim;
+  drv motor(0, sim);
+  drvPlant plant(sim);
+  plant.emfConstant = 0.008;
+  plant.resolution = 1.0;
+  plant.rotor = distance;
+  if (stop) {
+    plant.stopLow = 0;
+  }
+  drvStepper coils(motor, 0, 1, 2, 3, true);
+  coils.onStep = drvPlant::follow;
+  coils.stepContext = &plant;
+
+  HomingTask task(motor, coils, plant, -1);
+  task.maxSteps = stop ? distance + 48 + 400 : 5000;
+  long contact = -1;
+  Run run;
+  while ((run.result = task.poll()) == TASK_RUNNING) {
+    if (plant.stalled && contact < 0) {
+      contact = task.stallSteps;
+    }
+    plant.advance(1e6 / rate - plant.adcMicros);
+  }
+  run.latency = contact >= 0 ? task.stallSteps - contact : -1;
+  run.home = task.home + distance; // the stop is at -distance from the start
+  run.steps = task.stallSteps;
+  return run;
+}
+
+static const long distances[] = {0, 1, 10, 30, 47, 60, 233, 406, 579, 752, 925, 1098, 1271, 1444};
+
+int main() {
+  long worst = 0, runs = 0, homeError = 0;
+  for (float rate = 1000; rate <= 1600; rate += 100) {
+    for (uint8_t i = 0; i < sizeof(distances) / sizeof(distances[0]); i++) {
+      long distance = distances[i];
+      Run run = homing(distance, rate, true);
+      runs++;
+      if (!CHECK_EQ(run.result, TASK_DONE) || !CHECK(run.latency >= 0)) {
+        printf("  rate %.0f distance %ld\n", rate, distance);
+        continue;
+      }
+      worst = run.latency > worst ? run.latency : worst;
+      long error = run.home < 0 ? -run.home : run.home;
+      homeError = error > homeError ? error : homeError;
+    }
+  }
+  printf("%ld runs, worst latency %ld steps, worst home error %ld steps\n", runs, worst, homeError);
+  CHECK(worst <= 2);
+  CHECK_EQ(homeError, 0);
+
+  Run free = homing(0, 1000, false);
+  CHECK_EQ(free.result, TASK_FAILED);
+  CHECK_EQ(free.steps, 5000);
+
+  // the stop holds from both sides
+  drvSim sim;
+  drvPlant plant(sim);
+  plant.stopLow = -2;
+  plant.stopHigh = 2;
+  for (int i = 0; i < 5; i++) {
+    plant.step(1);
+  }
+  CHECK_EQ(plant.rotor, 2);
+  CHECK(plant.stalled);
+  for (int i = 0; i < 10; i++) {
+    plant.step(-1);
+  }
+  CHECK_EQ(plant.rotor, -2);
+  CHECK(plant.stalled);
+  plant.step(1);
+  CHECK_EQ(plant.rotor, -1);
+  CHECK(!plant.stalled);
+
+  return finish();
+}
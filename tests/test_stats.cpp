@@ -0,0 +1,84 @@
+/*
+  test_stats.cpp - drvStats counting, dump line length and the binary export
+
+  Only meaningful with DRV_STATS (cmake -DDRV_STATS=ON, CI builds both);
+  without it the test only checks that it builds.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <Logger.h>
+#include "check.h"
+
+// keeps the longest line it was given
+class LongestLine : public LogSink {
+    public:
+        LongestLine() : LogSink(LOG_INFO) { longest = 0; lines = 0; cut = 0; }
+        void write(const char* line, uint8_t len) {
+            lines++;
+            longest = len > longest ? len : longest;
+            if (line[len - 1] != '\n' || len >= LOGGER_LINE) {
+                cut++;
+            }
+        }
+        uint8_t longest;
+        int lines;
+        int cut;
+};
+
+// collects an export
+class Buffer : public Print {
+    public:
+        uint8_t data[STATS_EXPORT_SIZE + 8];
+        unsigned int len;
+        Buffer() { len = 0; }
+        size_t write(uint8_t c) { if (len < sizeof(data)) data[len++] = c; return 1; }
+        using Print::write;
+};
+
+int main() {
+#if DRV_STATS
+  drvSim sim;
+  drv motor(0, sim);
+
+  CHECK(motor.setTorque(10));
+  CHECK(!motor.setTorque(300));   // invalid input
+  CHECK(!motor.setISGain(7));     // invalid input
+  CHECK(!motor.setDecMode("odd")); // invalid input
+  CHECK_EQ(motor.stats.ops[STAT_TORQUE].calls, 2);
+  CHECK_EQ(motor.stats.ops[STAT_TORQUE].errors, 1);
+  CHECK_EQ(motor.stats.ops[STAT_ISGAIN].errors, 1);
+  CHECK_EQ(motor.stats.ops[STAT_DECMODE].errors, 1);
+
+  // saturated counters still fit behind the Logger prefix
+  for (uint8_t op = 0; op < STAT_OPS; op++) {
+    motor.stats.ops[op].calls = 0xFFFF;
+    motor.stats.ops[op].errors = 0xFFFF;
+    for (uint8_t b = 0; b < STATS_BUCKETS; b++) {
+      motor.stats.ops[op].buckets[b] = 0xFFFF;
+    }
+  }
+  motor.stats.recordIdle(0xFFFFFFFFUL, 0xFFFFFFFFUL);
+  Logger log("DRV8704", "info");
+  LongestLine sink;
+  log.addSink(&sink);
+  motor.stats.dump(log);
+  CHECK_EQ(sink.lines, 1 + 2 * STAT_OPS + 1);
+  CHECK_EQ(sink.cut, 0);
+  CHECK(sink.longest < LOGGER_LINE - 1);
+  printf("longest dump line: %u bytes\n", sink.longest);
+
+  // export round trip
+  Buffer out;
+  motor.stats.exportBinary(out);
+  CHECK_EQ(out.len, STATS_EXPORT_SIZE);
+  drvStats decoded;
+  CHECK(drvStatsDecode(out.data, out.len, decoded));
+  CHECK(memcmp(decoded.ops, motor.stats.ops, sizeof(decoded.ops)) == 0);
+  CHECK_EQ(decoded.idle.millis, 0xFFFFFFFFUL);
+#else
+  printf("built without DRV_STATS, nothing to check\n");
+#endif
+  return finish();
+}
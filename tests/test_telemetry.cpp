@@ -0,0 +1,135 @@
+/*
+  test_telemetry.cpp - drvTelemetry frames through drvTelemetryDecoder (request 036)
+
+  Samples at 1 kHz under a VirtualClock into a port with a settable amount
+  of room: every frame size (STATUS only, with registers, with the thermal
+  state, with both) decodes back to what was sent and fits the baud rate
+  the header gives for it; a corrupted CRC and a broken COBS frame are
+  counted in crcErrors, a sample the port had no room for in lost.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvClock.h>
+#include <drvTelemetry.h>
+#include "check.h"
+
+// keeps the last frame written
+class Port : public Print {
+    public:
+        uint8_t data[TELEMETRY_FRAME + 8];
+        unsigned int len;
+        int room;
+        Port() { len = 0; room = 64; }
+        size_t write(uint8_t c) { if (len < sizeof(data)) data[len++] = c; return 1; }
+        size_t write(const uint8_t* buffer, size_t size) {
+            len = 0;
+            for (size_t i = 0; i < size; i++) {
+                write(buffer[i]);
+            }
+            return size;
+        }
+        int availableForWrite() { return room; }
+};
+
+static bool feed(drvTelemetryDecoder& decoder, const uint8_t* data, unsigned int len,
+                 drvTelemetrySample& sample) {
+  bool got = false;
+  for (unsigned int i = 0; i < len; i++) {
+    got = decoder.feed(data[i], sample) || got;
+  }
+  return got;
+}
+
+int main() {
+  VirtualClock clock;
+  clock.install();
+  drvSim sim;
+  drv motor(0, sim);
+  motor.setLogging("off");
+  motor.updateTorque(0xA0);
+  sim.raiseFault(0x02);
+
+  drvThermalState thermal;
+  thermal.ceiling = 200;
+  thermal.applied = 0xA0;
+  thermal.heat = 40000;
+  thermal.tripHeat = 61000;
+
+  Port port;
+  drvTelemetryDecoder decoder;
+  drvTelemetrySample sample;
+
+  // sizes and the bandwidth at 1 kHz: 10 bits a byte on the UART
+  const unsigned int sizes[4] = {15, 29, 21, 35};
+  const unsigned long baud[4] = {250000, 500000, 250000, 500000};
+  for (uint8_t kind = 0; kind < 4; kind++) {
+    drvTelemetry telemetry(motor, port, 1000, kind & 1);
+    telemetry.thermal = (kind & 2) ? &thermal : 0;
+    delayMicroseconds(1000);
+    CHECK(telemetry.poll());
+    CHECK_EQ(port.len, sizes[kind]);
+    CHECK(port.len * 1000UL * 10 <= baud[kind]);
+
+    CHECK(feed(decoder, port.data, port.len, sample));
+    CHECK_EQ(sample.seq, 0);
+    CHECK_EQ(sample.status, 0x02);
+    CHECK_EQ(sample.torque, 0xA0);
+    CHECK_EQ(sample.flags & TELEMETRY_SHADOW, (kind & 1) ? TELEMETRY_SHADOW : 0);
+    if (kind & 1) {
+      for (uint8_t i = 0; i < TELEMETRY_REGS; i++) {
+        CHECK_EQ(sample.regs[i], motor.currentRegisterValues[i] & 0x0FFF);
+      }
+    }
+    if (kind & 2) {
+      CHECK_EQ(sample.ceiling, 200);
+      CHECK_EQ(sample.heat, 40000);
+      CHECK_EQ(sample.tripHeat, 61000);
+    }
+    decoder = drvTelemetryDecoder(); // each producer starts at seq 0
+  }
+  CHECK_EQ(sizes[3], TELEMETRY_FRAME);
+
+  drvTelemetry telemetry(motor, port, 1000, true);
+  telemetry.thermal = &thermal;
+  delayMicroseconds(1000);
+  CHECK(telemetry.poll());
+  CHECK(feed(decoder, port.data, port.len, sample));
+  CHECK_EQ(decoder.packets, 1);
+
+  // a wrong CRC: change the TORQUE byte inside the payload and re-frame it
+  delayMicroseconds(1000);
+  CHECK(telemetry.poll());
+  uint8_t payload[TELEMETRY_FRAME];
+  uint8_t size = drvCobsDecode(port.data, port.len - 1, payload);
+  CHECK(size > 0);
+  payload[9] ^= 0x01;
+  uint8_t frame[TELEMETRY_FRAME];
+  uint8_t length = drvCobsEncode(payload, size, frame);
+  frame[length++] = 0x00;
+  CHECK(!feed(decoder, frame, length, sample));
+  CHECK_EQ(decoder.crcErrors, 1);
+
+  // broken COBS: the first code byte points past the end of the frame
+  delayMicroseconds(1000);
+  CHECK(telemetry.poll());
+  port.data[0] = 0xFE;
+  CHECK(!feed(decoder, port.data, port.len, sample));
+  CHECK_EQ(decoder.crcErrors, 2);
+
+  // no room on the port: dropped here, a gap in the sequence over there
+  port.room = 10;
+  delayMicroseconds(1000);
+  CHECK(telemetry.poll());
+  CHECK_EQ(telemetry.dropped, 1);
+  port.room = 64;
+  delayMicroseconds(1000);
+  CHECK(telemetry.poll());
+  CHECK(feed(decoder, port.data, port.len, sample));
+  CHECK_EQ(sample.seq, 4);
+  CHECK_EQ(decoder.packets, 2);
+  CHECK_EQ(decoder.lost, 3); // the two corrupted frames and the dropped one
+
+  return finish();
+}
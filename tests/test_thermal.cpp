@@ -0,0 +1,127 @@
+/*
+  test_thermal.cpp - ThermalDerating against drvPlant (request 039)
+
+  TORQUE 255 held for 120 s of plant time, one derating update every 10 ms.
+  Without derating the plant trips OTS over and over (about 70 times); with
+  it the first trip teaches the trip level and at most one more follows,
+  and from then on the ceiling settles instead of flipping every period. A
+  part that never trips is never derated.
+  The plant's AOCP and UVLO latch in STATUS, stop the bridge and are counted
+  by the derating state.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvPlant.h>
+#include <drvThermal.h>
+#include "check.h"
+
+#define PERIODS 12000 // 120 s
+
+static unsigned long soak(bool derate, double* mean) {
+  drvSim sim;
+  drvPlant plant(sim);
+  drv motor(0, sim);
+  plant.resolution = 1.0;
+
+  ThermalDerating thermal(motor, 10000);
+  motor.updateTorque(255);
+  thermal.setTorque(255);
+  unsigned long changes = 0; // ceiling changes after the trip level is known
+  uint8_t ceiling = thermal.state.ceiling;
+  for (int i = 0; i < PERIODS; i++) {
+    plant.advance(10000);
+    if (derate) {
+      thermal.update(motor.read(motor.STATUS));
+      if (thermal.state.otsEvents && thermal.state.ceiling != ceiling) {
+        changes++;
+      }
+      ceiling = thermal.state.ceiling;
+    }
+  }
+  *mean = plant.sum / plant.window;
+  printf("derating %s: %lu OTS trips, %.1f s shut down, mean %.3f A, ceiling %u, %lu ceiling changes\n",
+         derate ? "on" : "off", plant.otsTrips, plant.shutdown / 1e6, *mean,
+         thermal.state.ceiling, changes);
+  if (derate) {
+    CHECK(thermal.state.ceiling < 255);
+    CHECK(thermal.state.tripHeat < 0xFFFF);
+    CHECK(changes <= PERIODS / 100);
+  }
+  return plant.otsTrips;
+}
+
+// TORQUE 255 on a board that never reaches OTS: heat climbs to full scale
+static void untripped() {
+  drvSim sim;
+  drvPlant plant(sim);
+  drv motor(0, sim);
+  plant.resolution = 1.0;
+  plant.otsTrip = 1000;
+
+  ThermalDerating thermal(motor, 10000);
+  motor.updateTorque(255);
+  thermal.setTorque(255);
+  unsigned long derated = 0;
+  for (int i = 0; i < PERIODS / 4; i++) {
+    plant.advance(10000);
+    thermal.update(motor.read(motor.STATUS));
+    if (thermal.state.ceiling != 255 || (sim.regs[motor.TORQUE] & 0xFF) != 255) {
+      derated++;
+    }
+  }
+  CHECK_EQ(plant.otsTrips, 0);
+  CHECK(thermal.state.heat > 60000);
+  CHECK_EQ(derated, 0);
+}
+
+static void protection() {
+  drvSim sim;
+  drvPlant plant(sim);
+  drv motor(0, sim);
+  ThermalDerating thermal(motor, 10000);
+  motor.updateTorque(255);
+
+  // overcurrent: latched until cleared
+  plant.ocpTrip = 1.0;
+  plant.advance(1000);
+  CHECK_EQ(plant.ocpTrips, 1);
+  CHECK(sim.regs[motor.STATUS] & 0x02);
+  plant.advance(1000);
+  CHECK(plant.current < 0.01);
+  CHECK_EQ(plant.ocpTrips, 1);
+  thermal.update(motor.read(motor.STATUS));
+  CHECK_EQ(thermal.state.ocpEvents, 1);
+  plant.ocpTrip = 8.0;
+  motor.clearFault(1);
+  CHECK_EQ(sim.regs[motor.STATUS] & 0x02, 0);
+  plant.advance(1000);
+  CHECK(plant.current > 1.0);
+
+  // undervoltage: holds the bridge off while low, clears by itself
+  plant.supply = 6.0;
+  plant.advance(1000);
+  CHECK(sim.regs[motor.STATUS] & 0x20);
+  CHECK(plant.current < 0.01);
+  thermal.update(motor.read(motor.STATUS));
+  CHECK_EQ(thermal.state.uvloEvents, 1);
+  plant.supply = 12.0;
+  plant.advance(1000);
+  CHECK_EQ(sim.regs[motor.STATUS] & 0x20, 0);
+  CHECK_EQ(plant.uvloTrips, 1);
+  CHECK(plant.current > 1.0);
+}
+
+int main() {
+  double open, derated;
+  unsigned long trips = soak(false, &open);
+  unsigned long derating = soak(true, &derated);
+  CHECK(trips >= 50);
+  CHECK(derating <= 2);
+  CHECK(derated > open); // backing off delivers more than tripping
+  untripped();
+
+  protection();
+  return finish();
+}
@@ -0,0 +1,59 @@
+/*
+  test_tuner.cpp - ChopperTuner against drvPlant (request 038)
+
+  12 V, 4 ohm, 4 mH, 3 V back EMF, TORQUE 140, target 300 counts: the tuner
+  must cut the score by at least 10x within its write budget, leave a valid
+  setting in the device and save it, and a second device restores that
+  image.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvPlant.h>
+#include <drvTuner.h>
+#include "check.h"
+
+int main() {
+  drvSim sim;
+  drvPlant plant(sim);
+  drv motor(0, sim);
+  plant.adcMicros = 13;
+  plant.backEmf = 3;
+  motor.updateTorque(140);
+
+  FileConfigStore store("test_tuner.cfg");
+  ChopperTuner tuner(motor, plant, 300);
+  tuner.store = &store;
+
+  unsigned long writes = sim.writes;
+  tuner.poll();
+  uint32_t baseline = tuner.bestScore;
+  CHECK_EQ(tuner.run(), TASK_DONE);
+  printf("score %u -> %u in %u evaluations, %u register writes (budget %u)\n",
+         baseline, tuner.bestScore, tuner.evaluations, tuner.writes, tuner.maxWrites);
+
+  CHECK(baseline >= 400);
+  CHECK(tuner.bestScore * 10 <= baseline);
+  CHECK(tuner.evaluations <= 60);
+  CHECK(tuner.writes <= tuner.maxWrites + 4);
+  CHECK_EQ(sim.writes - writes, tuner.writes);
+  CHECK(ChopperTuner::valid(tuner.best));
+
+  // the device holds the best settings
+  CHECK_EQ(sim.regs[motor.OFF] & 0xFF, tuner.best.toff);
+  CHECK_EQ(sim.regs[motor.BLANK] & 0xFF, tuner.best.tblank);
+  CHECK_EQ(sim.regs[motor.DECAY] & 0xFF, tuner.best.tdecay);
+  CHECK_EQ((sim.regs[motor.DECAY] >> 8) & 0x7, tuner.best.decMode);
+
+  // and a second device comes up with them from the store
+  drvSim other;
+  drv restored(0, other);
+  CHECK(restored.restoreConfig(store) > 0);
+  for (uint8_t i = 1; i < 5; i++) {
+    CHECK_EQ(other.regs[i], sim.regs[i]);
+  }
+  remove("test_tuner.cfg");
+
+  return finish();
+}
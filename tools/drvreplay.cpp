@@ -0,0 +1,111 @@
+/*
+  drvreplay.cpp - replays a TraceTransport capture on the host
+
+  Feeds a dump (trace.dump(Serial) on the unit, saved to a file) into a
+  drvSim through drvReplay(), reports how many responses differ from the
+  recording, and times the replay:
+
+    drvreplay                  records a built in session on a drvSim and
+                               replays it (what ctest runs)
+    drvreplay capture.bin      replays a capture
+    drvreplay capture.bin 1000 replays it 1000 times, for timing
+
+  A response that differs from the recording marks where the device state
+  changed outside the bus: the built in session latches an AOCP between two
+  frames, so its STATUS read is the one expected mismatch. The recorded span
+  against the frames' wire time at 140 kHz shows how much of the session
+  the bus was busy. Exits 1 if the capture is invalid or the built in
+  session does not replay as expected.
+
+*/
+#include <Arduino.h>
+#include <drv.h>
+#include <drvSim.h>
+#include <drvTrace.h>
+#include <drvTask.h>
+#include <time.h>
+
+#define SESSION_FRAMES 512
+
+// a Print into memory, for the dump
+class Capture : public Print {
+    public:
+        uint8_t data[TRACE_HEADER_SIZE + SESSION_FRAMES * TRACE_ENTRY_SIZE];
+        unsigned int len;
+        Capture() { len = 0; }
+        size_t write(uint8_t c) {
+            if (len == sizeof(data)) {
+                return 0;
+            }
+            data[len++] = c;
+            return 1;
+        }
+        using Print::write;
+};
+
+static uint64_t nanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// probe, configure, switch profiles, a latched fault and its recovery
+static void record(Capture& out) {
+  static drvTraceEntry ring[SESSION_FRAMES];
+  drvSim sim;
+  TraceTransport trace(sim, ring, SESSION_FRAMES);
+  drv motor(0, trace);
+
+  motor.getCurrentRegisters();
+  motor.setTorque(0x80);
+  motor.setISGain(20);
+  motor.setDecMode("mixed");
+  motor.setHbridge("on");
+  motor.switchProfile(PROFILE_HOLD);
+  motor.switchProfile(PROFILE_RUN);
+  sim.raiseFault(0x02); // outside the bus, the replay cannot reproduce it
+  FaultRecoveryTask recovery(&motor);
+  recovery.run();
+  motor.getCurrentRegisters();
+
+  trace.dump(out);
+}
+
+int main(int argc, char** argv) {
+  static Capture capture;
+  bool builtIn = argc < 2;
+  if (builtIn) {
+    record(capture);
+  } else {
+    FILE* f = fopen(argv[1], "rb");
+    if (!f) {
+      printf("drvreplay: cannot open %s\n", argv[1]);
+      return 1;
+    }
+    capture.len = fread(capture.data, 1, sizeof(capture.data), f);
+    fclose(f);
+  }
+  unsigned long repeats = argc > 2 ? strtoul(argv[2], 0, 10) : 1000;
+  if (repeats == 0) {
+    repeats = 1;
+  }
+
+  drvReplayResult result;
+  uint64_t start = nanos();
+  for (unsigned long i = 0; i < repeats; i++) {
+    drvSim target;
+    if (!drvReplay(capture.data, capture.len, target, result)) {
+      printf("drvreplay: not a trace dump (version %d)\n", TRACE_VERSION);
+      return 1;
+    }
+  }
+  double perFrame = (double)(nanos() - start) / repeats / (result.frames ? result.frames : 1);
+
+  printf("frames %u (reads %u, writes %u)\n", result.frames, result.reads, result.writes);
+  printf("mismatches %u, first at %ld\n", result.mismatches, (long)result.firstMismatch);
+  printf("recorded span %lu us, wire time at 140 kHz %lu us\n",
+         (unsigned long)result.span, (unsigned long)result.frames * 116UL);
+  printf("replay: %.1f ns/frame\n", perFrame);
+
+  return builtIn && result.mismatches != 1 ? 1 : 0;
+}